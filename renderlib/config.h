@@ -25,6 +25,165 @@ extern "C" {
  */
 #define LATENCY_TO_HDMI_TIME_US 48000
 
+/*
+ * the max latency from wayland client to display,the measured
+ * latency larger than it is ignored,e.g. frames held when pausing
+ */
+#define MAX_LATENCY_TO_HDMI_TIME_US 200000
+
+/*
+ * the weight of display latency feedback,a presentation error
+ * against scheduled time moves the estimate 1/weight of it
+ */
+#define LATENCY_ESTIMATE_WEIGHT 8
+
+/*
+ * the presentation error display latency estimate settles at,
+ * compositor holds early frames until their time,so on time
+ * frames show error near 0 and move the estimate down,late
+ * frames move it up
+ */
+#define LATENCY_TARGET_ERROR_US 2000
+
+/*
+ * the time to hold a frame when plugin is busy and
+ * refuses to take it,frame is retried after this time
+ */
+#define PLUGIN_BUSY_HOLD_TIME_US 2000
+
+/*
+ * max frames dropped in one pass when render core catches up
+ * with the sync clock after a stall
+ */
+#define MAX_CATCHUP_DROP_FRAMES 64
+
+/*
+ * pts discontinuity threshold of free run clock,frame
+ * further than it from the clock anchors the clock again
+ */
+#define FREE_RUN_REANCHOR_THRESHOLD_US 1000000
+
+/*
+ * min confidence(0~100) of estimated frame rate that takes
+ * place of the frame rate set by user
+ */
+#define FPS_ESTIMATE_MIN_CONFIDENCE 80
+
+/*
+ * min display refresh rate,mHz,content slower than it
+ * prefers integer multiple of its frame rate
+ */
+#define MIN_DISPLAY_REFRESH_RATE_MHZ 23000
+
+/*
+ * display refresh rate used when compositor does not report it,mHz
+ */
+#define DEFAULT_DISPLAY_REFRESH_RATE_MHZ 60000
+
+/*
+ * max depth of pts reorder window
+ */
+#define MAX_REORDER_DEPTH 8
+
+/*
+ * backward pts jump larger than it in reorder window is
+ * a discontinuity,not a out of order frame
+ */
+#define REORDER_DISCONTINUITY_THRESHOLD_NS 500000000LL
+
+/*
+ * frames left in reorder window are emitted if no
+ * new frame comes in this time
+ */
+#define REORDER_DRAIN_TIME_US 100000
+
+/*
+ * max time producer is blocked when render queue is full
+ * and queue full policy is QUEUE_FULL_POLICY_BLOCK
+ */
+#define QUEUE_FULL_BLOCK_TIMEOUT_US 100000
+
+/*
+ * max frames held in queue by jitter buffer
+ */
+#define JITTER_MAX_DEPTH 16
+
+/*
+ * jitter buffer target depth shrinks one frame at
+ * most in this time,it grows at once
+ */
+#define JITTER_SHRINK_INTERVAL_US 2000000
+
+/*
+ * rate slewed by jitter buffer to converge queue
+ * depth to target,0.005 is 0.5%
+ */
+#define JITTER_SLEW_RATE 0.005f
+
+/*
+ * max time jitter buffer waits queue filling to
+ * target depth before first frame is displayed
+ */
+#define JITTER_PREBUFFER_MAX_US 500000
+
+/*
+ * default min interval of qos msg,ms
+ */
+#define QOS_DEFAULT_INTERVAL_MS 500
+
+/*
+ * weight of a frame in smoothed drop rate,about
+ * the frames count the rate is averaged over
+ */
+#define QOS_DROP_RATE_WEIGHT 16
+
+/*
+ * smoothed drop rate,per thousand,from which
+ * qos suggests skipping non-reference frames
+ */
+#define QOS_SKIP_NON_REF_DROP_RATE 20
+
+/*
+ * smoothed drop rate,per thousand,from which
+ * qos suggests lowering resolution
+ */
+#define QOS_LOWER_RESOLUTION_DROP_RATE 250
+
+/*
+ * max frames cached by a standby render instance,
+ * older ones are dropped so decoder does not stall
+ */
+#define STANDBY_MAX_CACHED_FRAMES 4
+
+/*
+ * plugins parked by session cache are closed if
+ * not reused in this time,ms
+ */
+#define SESSION_CACHE_IDLE_TIMEOUT_MS 5000
+
+/*
+ * max plugins parked by session cache
+ */
+#define SESSION_CACHE_MAX_PLUGINS 2
+
+/*
+ * max time to wait compositor returning buffers before
+ * a plugin is parked by session cache,ms
+ */
+#define SESSION_CACHE_PARK_WAIT_MS 100
+
+/*
+ * staged window geometry is published at once if no
+ * video frame was committed in this time,us
+ */
+#define GEOMETRY_STAGE_TIMEOUT_US 100000
+
+/*
+ * max time display thread waits a pacing event,us,
+ * changes not posted as event are seen after it
+ */
+#define PACING_IDLE_WAIT_US 100000
+
 #ifdef  __cplusplus
 }
 #endif
@@ -0,0 +1,184 @@
+#include <limits.h>
+#include "display_scheduler.h"
+#include "render_core.h"
+#include "Times.h"
+#include "Logger.h"
+#include "config.h"
+
+#define TAG "rlib:display_scheduler"
+
+DisplayScheduler *DisplayScheduler::getInstance()
+{
+    //lives until process exits,cores may come and go
+    static DisplayScheduler *instance = new DisplayScheduler();
+    return instance;
+}
+
+DisplayScheduler::DisplayScheduler()
+    : mListMutex("schedulerListMutex"),
+    mWakeMutex("schedulerWakeMutex")
+{
+    mWakePending = false;
+    mGridStartUs = 0;
+    mRefreshRate = DEFAULT_DISPLAY_REFRESH_RATE_MHZ;
+    mSchedulerThreadValid = false;
+}
+
+DisplayScheduler::~DisplayScheduler()
+{
+}
+
+void DisplayScheduler::addCore(RenderCore *core)
+{
+    ScheduledCore scheduled;
+
+    mListMutex.lock();
+    scheduled.core = core;
+    scheduled.ready = false;
+    scheduled.busy = false;
+    scheduled.removed = false;
+    mCores.push_back(scheduled);
+    if (mGridStartUs == 0) {
+        mGridStartUs = Tls::Times::getSystemTimeUs();
+    }
+    INFO(core->getLogCategory(),"add to shared display scheduler,cores:%d",(int)mCores.size());
+    mListMutex.unlock();
+
+    if (!isRunning()) {
+        run("displayscheduler");
+    }
+    wakeup();
+}
+
+void DisplayScheduler::removeCore(RenderCore *core)
+{
+    Tls::Mutex::Autolock _l(mListMutex);
+    bool onScheduler = mSchedulerThreadValid && pthread_equal(pthread_self(), mSchedulerThread);
+    for (auto item = mCores.begin(); item != mCores.end(); item++) {
+        if (item->core == core) {
+            //waiting own pass would never return,drop it after pass
+            if (onScheduler && item->busy) {
+                item->removed = true;
+                INFO(core->getLogCategory(),"removed on scheduler thread,drop after pass");
+                return;
+            }
+            //pass of this core runs without list lock
+            while (item->busy) {
+                mIdleCondition.wait(mListMutex);
+            }
+            mCores.erase(item);
+            break;
+        }
+    }
+    INFO(core->getLogCategory(),"remove from shared display scheduler,cores:%d",(int)mCores.size());
+}
+
+void DisplayScheduler::wakeup()
+{
+    Tls::Mutex::Autolock _l(mWakeMutex);
+    mWakePending = true;
+    mWakeCondition.signal();
+}
+
+bool DisplayScheduler::isRemoved(RenderCore *core)
+{
+    Tls::Mutex::Autolock _l(mListMutex);
+    for (auto item = mCores.begin(); item != mCores.end(); item++) {
+        if (item->core == core) {
+            return item->removed;
+        }
+    }
+    return true;
+}
+
+void DisplayScheduler::readyToRun()
+{
+    Tls::Mutex::Autolock _l(mListMutex);
+    mSchedulerThread = pthread_self();
+    mSchedulerThreadValid = true;
+}
+
+int64_t DisplayScheduler::alignToVsync(int64_t timeUs)
+{
+    int64_t vsyncUs = 1000000000LL / mRefreshRate;
+    int64_t vsyncCnt = (timeUs - mGridStartUs + vsyncUs - 1) / vsyncUs;
+    return mGridStartUs + vsyncCnt * vsyncUs;
+}
+
+bool DisplayScheduler::threadLoop()
+{
+    int64_t nowUs;
+    int64_t nextWakeUs = INT64_MAX;
+    int refreshRate = 0;
+    std::vector<ScheduledCore> dueCores;
+
+    //due cores are marked busy,so they stay registered while
+    //their passes run without list lock
+    mListMutex.lock();
+    nowUs = Tls::Times::getSystemTimeUs();
+    for (auto item = mCores.begin(); item != mCores.end(); item++) {
+        int64_t wakeUs = item->core->getNextWakeUs();
+        if (wakeUs <= nowUs) {
+            item->busy = true;
+            dueCores.push_back(*item);
+        } else if (wakeUs < nextWakeUs) {
+            nextWakeUs = wakeUs;
+        }
+        if (item->core->getDisplayRefreshRate() > refreshRate) {
+            refreshRate = item->core->getDisplayRefreshRate();
+        }
+    }
+    if (refreshRate > 0) {
+        mRefreshRate = refreshRate;
+    }
+    mListMutex.unlock();
+
+    //plugin and mediasync calls of a core do not block add and remove,
+    //frames of due cores are staged in commit batch and published
+    //back to back after all passes,so they land in one repaint
+    for (size_t i = 0; i < dueCores.size(); i++) {
+        if (isRemoved(dueCores[i].core)) {
+            continue;
+        }
+        dueCores[i].core->setCommitBatch(true);
+        int64_t wakeUs = dueCores[i].core->runScheduledPass(!dueCores[i].ready);
+        if (wakeUs < nextWakeUs) {
+            nextWakeUs = wakeUs;
+        }
+    }
+    for (size_t i = 0; i < dueCores.size(); i++) {
+        dueCores[i].core->setCommitBatch(false);
+    }
+
+    mListMutex.lock();
+    for (size_t i = 0; i < dueCores.size(); i++) {
+        for (auto item = mCores.begin(); item != mCores.end(); item++) {
+            if (item->core == dueCores[i].core) {
+                item->busy = false;
+                item->ready = true;
+                if (item->removed) {
+                    mCores.erase(item);
+                }
+                break;
+            }
+        }
+    }
+    mIdleCondition.broadcast();
+    mListMutex.unlock();
+
+    //timed passes begin on vsync grid,so frames of all cores
+    //due in a vsync are submitted in one wakeup
+    Tls::Mutex::Autolock _l(mWakeMutex);
+    if (!mWakePending && nextWakeUs > nowUs) {
+        if (nextWakeUs == INT64_MAX) {
+            mWakeCondition.wait(mWakeMutex);
+        } else {
+            int64_t waitUs = alignToVsync(nextWakeUs) - Tls::Times::getSystemTimeUs();
+            if (waitUs > 0) {
+                mWakeCondition.waitRelativeUs(mWakeMutex, waitUs);
+            }
+        }
+    }
+    mWakePending = false;
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef __DISPLAY_SCHEDULER_H__
+#define __DISPLAY_SCHEDULER_H__
+#include <stdint.h>
+#include <pthread.h>
+#include <list>
+#include <vector>
+#include "Thread.h"
+#include "Mutex.h"
+#include "Condition.h"
+
+class RenderCore;
+
+/**
+ * @brief process wide display thread shared by render cores,
+ * e.g. main video plus pip or mosaic tiles.display passes of
+ * all registered cores run in one wakeup on vsync grid,so
+ * tiles are submitted to compositor together
+ */
+class DisplayScheduler : public Tls::Thread {
+  public:
+    static DisplayScheduler *getInstance();
+    /**
+     * @brief register a render core,its display passes run on
+     * scheduler thread from now on
+     *
+     * @param core render core
+     */
+    void addCore(RenderCore *core);
+    /**
+     * @brief unregister a render core,waits the pass running now,
+     * on scheduler thread the core is only marked removed and
+     * dropped when its pass finished
+     *
+     * @param core render core
+     */
+    void removeCore(RenderCore *core);
+    /**
+     * @brief run a pass at once,not waiting vsync grid
+     */
+    void wakeup();
+    //thread func
+    virtual void readyToRun();
+    virtual bool threadLoop();
+  private:
+    DisplayScheduler();
+    virtual ~DisplayScheduler();
+    int64_t alignToVsync(int64_t timeUs);
+    bool isRemoved(RenderCore *core);
+
+    typedef struct {
+        RenderCore *core;
+        bool ready; /*readyToRun of core done*/
+        bool busy; /*pass of core running,list lock not held*/
+        bool removed; /*removed on scheduler thread,dropped after pass*/
+    } ScheduledCore;
+
+    mutable Tls::Mutex mListMutex; /*guard cores list*/
+    Tls::Condition mIdleCondition; /*a core pass finished*/
+    std::list<ScheduledCore> mCores;
+    mutable Tls::Mutex mWakeMutex;
+    Tls::Condition mWakeCondition;
+    bool mWakePending;
+    int64_t mGridStartUs; /*system time vsync grid begins*/
+    int mRefreshRate; /*max refresh rate of cores,mHz*/
+    pthread_t mSchedulerThread;
+    bool mSchedulerThreadValid; /*mSchedulerThread is set*/
+};
+
+#endif /*__DISPLAY_SCHEDULER_H__*/
@@ -0,0 +1,116 @@
+#include <string.h>
+#include <algorithm>
+#include "frame_rate_estimator.h"
+
+/*pts delta larger than it is a discontinuity,ns*/
+#define MAX_FRAME_INTERVAL_NS (1000000000LL)
+/*delta fits an interval if within 1/10 of it*/
+#define FIT_TOLERANCE_DIV (10)
+
+FrameRateEstimator::FrameRateEstimator()
+{
+    reset();
+}
+
+FrameRateEstimator::~FrameRateEstimator()
+{
+}
+
+void FrameRateEstimator::reset()
+{
+    mLastPts = -1;
+    memset(mDeltas, 0, sizeof(mDeltas));
+    mDeltaHead = 0;
+    mDeltaCnt = 0;
+    mIntervalNs = 0;
+    mConfidence = 0;
+    mPulldown = false;
+}
+
+void FrameRateEstimator::addPts(int64_t ptsNs)
+{
+    if (ptsNs < 0) {
+        return;
+    }
+
+    if (mLastPts >= 0) {
+        int64_t delta = ptsNs - mLastPts;
+        if (delta > 0 && delta <= MAX_FRAME_INTERVAL_NS) {
+            mDeltas[mDeltaHead] = delta;
+            mDeltaHead = (mDeltaHead + 1) % FPS_ESTIMATE_WINDOW;
+            if (mDeltaCnt < FPS_ESTIMATE_WINDOW) {
+                mDeltaCnt++;
+            }
+            estimate();
+        }
+    }
+    mLastPts = ptsNs;
+}
+
+static bool fitInterval(int64_t delta, int64_t interval)
+{
+    int64_t diff = delta > interval? delta - interval : interval - delta;
+    return diff * FIT_TOLERANCE_DIV <= interval;
+}
+
+bool FrameRateEstimator::detectPulldown(int64_t *sorted, int cnt)
+{
+    //median of lower and upper half are the two and three field times
+    int64_t shortDelta = sorted[cnt/4];
+    int64_t longDelta = sorted[cnt - 1 - cnt/4];
+    int shortCnt = 0;
+    int longCnt = 0;
+
+    //three fields against two fields is 1.5
+    if (longDelta * 20 < shortDelta * 27 || longDelta * 20 > shortDelta * 33) {
+        return false;
+    }
+    for (int i = 0; i < cnt; i++) {
+        if (fitInterval(sorted[i], shortDelta)) {
+            shortCnt++;
+        } else if (fitInterval(sorted[i], longDelta)) {
+            longCnt++;
+        }
+    }
+    if (shortCnt * 3 < cnt || longCnt * 3 < cnt) {
+        return false;
+    }
+    mIntervalNs = (shortDelta + longDelta) / 2;
+    mConfidence = (shortCnt + longCnt) * 100 / cnt;
+    return true;
+}
+
+void FrameRateEstimator::estimate()
+{
+    int64_t sorted[FPS_ESTIMATE_WINDOW];
+    int64_t sum = 0;
+    int fitCnt = 0;
+    int start, end;
+
+    if (mDeltaCnt < FPS_ESTIMATE_MIN_SAMPLES) {
+        return;
+    }
+
+    memcpy(sorted, mDeltas, mDeltaCnt * sizeof(int64_t));
+    std::sort(sorted, sorted + mDeltaCnt);
+
+    mPulldown = detectPulldown(sorted, mDeltaCnt);
+    if (mPulldown) {
+        return;
+    }
+
+    //trimmed mean,drop a quarter on both sides
+    start = mDeltaCnt / 4;
+    end = mDeltaCnt - mDeltaCnt / 4;
+    for (int i = start; i < end; i++) {
+        sum += sorted[i];
+    }
+    mIntervalNs = sum / (end - start);
+
+    for (int i = 0; i < mDeltaCnt; i++) {
+        if (fitInterval(sorted[i], mIntervalNs)) {
+            fitCnt++;
+        }
+    }
+    mConfidence = fitCnt * 100 / mDeltaCnt;
+}
@@ -0,0 +1,69 @@
+#ifndef __FRAME_RATE_ESTIMATOR_H__
+#define __FRAME_RATE_ESTIMATOR_H__
+#include <stdint.h>
+
+/*count of pts deltas kept in sliding window*/
+#define FPS_ESTIMATE_WINDOW 32
+/*min count of pts deltas before an estimate is given*/
+#define FPS_ESTIMATE_MIN_SAMPLES 8
+
+/**
+ * @brief estimate frame interval from input frame pts
+ * continuously,the estimate follows the content rate
+ * changes in about half of window frames
+ */
+class FrameRateEstimator {
+  public:
+    FrameRateEstimator();
+    virtual ~FrameRateEstimator();
+    /**
+     * @brief add a input frame pts,pts gaps larger than
+     * one second or going back are treated as discontinuity
+     * and not counted
+     *
+     * @param ptsNs frame pts,ns unit,negative pts is ignored
+     */
+    void addPts(int64_t ptsNs);
+    void reset();
+    /**
+     * @brief Get the estimated frame interval
+     *
+     * @return int64_t interval ns,0 if not enough samples
+     */
+    int64_t getIntervalNs() {
+        return mIntervalNs;
+    };
+    /**
+     * @brief Get the confidence of estimated frame interval
+     *
+     * @return int 0~100,the percent of window deltas that fit
+     * the estimate
+     */
+    int getConfidence() {
+        return mConfidence;
+    };
+    /**
+     * @brief check if pts deltas have 3:2 pulldown cadence,
+     * e.g. 24fps telecined to 60 fields,deltas alternate
+     * between two and three field times
+     *
+     * @return true if cadence detected
+     */
+    bool isPulldownCadence() {
+        return mPulldown;
+    };
+  private:
+    void estimate();
+    bool detectPulldown(int64_t *sorted, int cnt);
+
+    int64_t mLastPts;
+    int64_t mDeltas[FPS_ESTIMATE_WINDOW];
+    int mDeltaHead;
+    int mDeltaCnt;
+
+    int64_t mIntervalNs;
+    int mConfidence;
+    bool mPulldown;
+};
+
+#endif /*__FRAME_RATE_ESTIMATOR_H__*/
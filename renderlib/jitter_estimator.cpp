@@ -0,0 +1,74 @@
+#include <string.h>
+#include <algorithm>
+#include "jitter_estimator.h"
+
+/*delay change larger than it is pts discontinuity,us*/
+#define MAX_ARRIVAL_DELAY_US (1000000LL)
+
+JitterEstimator::JitterEstimator()
+{
+    reset();
+}
+
+JitterEstimator::~JitterEstimator()
+{
+}
+
+void JitterEstimator::reset()
+{
+    mBasePts = -1;
+    mBaseArrivalUs = 0;
+    mRate = 1.0f;
+    memset(mDelays, 0, sizeof(mDelays));
+    mDelayHead = 0;
+    mDelayCnt = 0;
+    mJitterUs = 0;
+}
+
+void JitterEstimator::addArrival(int64_t ptsNs, int64_t arrivalUs, float rate)
+{
+    int64_t delayUs;
+
+    if (ptsNs < 0 || rate <= 0.0f) {
+        return;
+    }
+    if (mBasePts < 0 || rate != mRate) {
+        reset();
+        mBasePts = ptsNs;
+        mBaseArrivalUs = arrivalUs;
+        mRate = rate;
+    }
+
+    delayUs = arrivalUs - mBaseArrivalUs - (int64_t)((ptsNs - mBasePts)/1000/mRate);
+    if (delayUs > MAX_ARRIVAL_DELAY_US || delayUs < -MAX_ARRIVAL_DELAY_US) {
+        reset();
+        mBasePts = ptsNs;
+        mBaseArrivalUs = arrivalUs;
+        mRate = rate;
+        delayUs = 0;
+    }
+
+    mDelays[mDelayHead] = delayUs;
+    mDelayHead = (mDelayHead + 1) % JITTER_ESTIMATE_WINDOW;
+    if (mDelayCnt < JITTER_ESTIMATE_WINDOW) {
+        mDelayCnt++;
+    }
+    estimate();
+}
+
+void JitterEstimator::estimate()
+{
+    int64_t sorted[JITTER_ESTIMATE_WINDOW];
+    int64_t minDelay;
+    int pos;
+
+    if (mDelayCnt < JITTER_ESTIMATE_MIN_SAMPLES) {
+        return;
+    }
+
+    memcpy(sorted, mDelays, mDelayCnt * sizeof(int64_t));
+    minDelay = *std::min_element(sorted, sorted + mDelayCnt);
+    pos = (mDelayCnt - 1) * JITTER_ESTIMATE_PERCENTILE / 100;
+    std::nth_element(sorted, sorted + pos, sorted + mDelayCnt);
+    mJitterUs = sorted[pos] - minDelay;
+}
@@ -0,0 +1,51 @@
+#ifndef __JITTER_ESTIMATOR_H__
+#define __JITTER_ESTIMATOR_H__
+#include <stdint.h>
+
+/*count of arrival delays kept in sliding window*/
+#define JITTER_ESTIMATE_WINDOW 128
+/*min count of arrival delays before an estimate is given*/
+#define JITTER_ESTIMATE_MIN_SAMPLES 16
+/*percentile of arrival delays covered by estimated jitter*/
+#define JITTER_ESTIMATE_PERCENTILE 95
+
+/**
+ * @brief estimate input frame arrival jitter,the delay of a
+ * frame is its arrival time against its pts,jitter is the
+ * spread of delays in window from least to percentile
+ */
+class JitterEstimator {
+  public:
+    JitterEstimator();
+    virtual ~JitterEstimator();
+    /**
+     * @brief add a input frame arrival,rate change or pts
+     * discontinuity starts the estimate again
+     *
+     * @param ptsNs frame pts,ns unit,negative pts is ignored
+     * @param arrivalUs system time frame arrived,us unit
+     * @param rate playback rate
+     */
+    void addArrival(int64_t ptsNs, int64_t arrivalUs, float rate);
+    void reset();
+    /**
+     * @brief Get the estimated jitter
+     *
+     * @return int64_t jitter us,0 if not enough samples
+     */
+    int64_t getJitterUs() {
+        return mJitterUs;
+    };
+  private:
+    void estimate();
+
+    int64_t mBasePts;
+    int64_t mBaseArrivalUs;
+    float mRate;
+    int64_t mDelays[JITTER_ESTIMATE_WINDOW];
+    int mDelayHead;
+    int mDelayCnt;
+    int64_t mJitterUs;
+};
+
+#endif /*__JITTER_ESTIMATOR_H__*/
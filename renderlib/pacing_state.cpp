@@ -0,0 +1,109 @@
+#include "pacing_state.h"
+
+PacingStateMachine::PacingStateMachine()
+{
+    mState = PACING_STATE_IDLE;
+    mPaused = false;
+    mPrerolled = false;
+}
+
+PacingStateMachine::~PacingStateMachine()
+{
+}
+
+int PacingStateMachine::postEvent(int event)
+{
+    switch (event) {
+        case PACING_EVENT_FRAME_QUEUED: {
+            if (mState == PACING_STATE_IDLE || mState == PACING_STATE_DRAINING) {
+                mState = frameState();
+            }
+        } break;
+        case PACING_EVENT_QUEUE_EMPTY: {
+            if (isDisplaying() || mState == PACING_STATE_DRAINING) {
+                mState = PACING_STATE_IDLE;
+            }
+        } break;
+        case PACING_EVENT_REORDER_HELD: {
+            if (isDisplaying() || mState == PACING_STATE_IDLE) {
+                mState = PACING_STATE_DRAINING;
+            }
+        } break;
+        case PACING_EVENT_FRAME_SHOWN: {
+            //frame displayed while flushing is of old generation
+            if (mState == PACING_STATE_FLUSHING) {
+                break;
+            }
+            mPrerolled = true;
+            if (mState == PACING_STATE_PREROLL) {
+                mState = PACING_STATE_PLAYING;
+            }
+        } break;
+        case PACING_EVENT_PAUSE: {
+            mPaused = true;
+            if (mState != PACING_STATE_FLUSHING) {
+                mState = PACING_STATE_PAUSED;
+            }
+        } break;
+        case PACING_EVENT_RESUME: {
+            mPaused = false;
+            //display thread finds out if queue is empty
+            if (mState == PACING_STATE_PAUSED) {
+                mState = frameState();
+            }
+        } break;
+        case PACING_EVENT_FLUSH_START: {
+            mPrerolled = false;
+            mState = PACING_STATE_FLUSHING;
+        } break;
+        case PACING_EVENT_FLUSH_END: {
+            if (mState == PACING_STATE_FLUSHING) {
+                mState = mPaused? PACING_STATE_PAUSED : PACING_STATE_IDLE;
+            }
+        } break;
+        case PACING_EVENT_RESET: {
+            mPrerolled = false;
+            mState = mPaused? PACING_STATE_PAUSED : PACING_STATE_IDLE;
+        } break;
+        default:
+            break;
+    }
+    return mState;
+}
+
+int PacingStateMachine::postQueueState(int queuedCnt, bool reorderHeld)
+{
+    if (queuedCnt > 0) {
+        return postEvent(PACING_EVENT_FRAME_QUEUED);
+    }
+    return postEvent(reorderHeld? PACING_EVENT_REORDER_HELD : PACING_EVENT_QUEUE_EMPTY);
+}
+
+const char *PacingStateMachine::stateName(int state)
+{
+    switch (state) {
+        case PACING_STATE_IDLE: return "idle";
+        case PACING_STATE_PREROLL: return "preroll";
+        case PACING_STATE_PLAYING: return "playing";
+        case PACING_STATE_PAUSED: return "paused";
+        case PACING_STATE_FLUSHING: return "flushing";
+        case PACING_STATE_DRAINING: return "draining";
+        default: return "unknown";
+    }
+}
+
+const char *PacingStateMachine::eventName(int event)
+{
+    switch (event) {
+        case PACING_EVENT_FRAME_QUEUED: return "frame queued";
+        case PACING_EVENT_QUEUE_EMPTY: return "queue empty";
+        case PACING_EVENT_REORDER_HELD: return "reorder held";
+        case PACING_EVENT_FRAME_SHOWN: return "frame shown";
+        case PACING_EVENT_PAUSE: return "pause";
+        case PACING_EVENT_RESUME: return "resume";
+        case PACING_EVENT_FLUSH_START: return "flush start";
+        case PACING_EVENT_FLUSH_END: return "flush end";
+        case PACING_EVENT_RESET: return "reset";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef __PACING_STATE_H__
+#define __PACING_STATE_H__
+#include <stdint.h>
+
+/*display pacing state,each state defines what display thread waits on*/
+enum _PacingState {
+    PACING_STATE_IDLE = 0, //no frame queued,wait frame
+    PACING_STATE_PREROLL, //first frame after start or flush not displayed
+    PACING_STATE_PLAYING, //frames displayed at their due time
+    PACING_STATE_PAUSED, //no frame displayed,wait resume or flush
+    PACING_STATE_FLUSHING, //queue is being flushed,wait flush end
+    PACING_STATE_DRAINING, //display queue empty,frames held in reorder window,wait drain time
+};
+
+/*events posted to pacing state machine*/
+enum _PacingEvent {
+    PACING_EVENT_FRAME_QUEUED = 0, //frame pushed to display queue
+    PACING_EVENT_QUEUE_EMPTY, //display queue found empty
+    PACING_EVENT_REORDER_HELD, //display queue empty,reorder window not
+    PACING_EVENT_FRAME_SHOWN, //a frame had displayed
+    PACING_EVENT_PAUSE,
+    PACING_EVENT_RESUME,
+    PACING_EVENT_FLUSH_START,
+    PACING_EVENT_FLUSH_END,
+    PACING_EVENT_RESET, //session stopped,pause request is kept
+};
+
+/**
+ * @brief frame pacing state machine of display thread,the
+ * transitions are pure,caller guards it with its own lock
+ * and wakes display thread when state changed
+ */
+class PacingStateMachine {
+  public:
+    PacingStateMachine();
+    virtual ~PacingStateMachine();
+    /**
+     * @brief post a event,pause request is kept across flush
+     * and reset,first frame is prerolled again after them
+     *
+     * @param event see _PacingEvent
+     * @return int the state after event,see _PacingState
+     */
+    int postEvent(int event);
+    /**
+     * @brief post display queue state found by display thread,
+     * a frame queued while flushing has its event ignored,so
+     * a queue holding frames enters preroll or playing here
+     *
+     * @param queuedCnt frames in display queue
+     * @param reorderHeld frames held in reorder window
+     * @return int the state after event,see _PacingState
+     */
+    int postQueueState(int queuedCnt, bool reorderHeld);
+    int getState() {
+        return mState;
+    };
+    /**
+     * @brief check if pause is requested,it may be still
+     * flushing
+     */
+    bool isPaused() {
+        return mPaused;
+    };
+    /**
+     * @brief check if display thread may take frames from
+     * display queue
+     */
+    bool isDisplaying() {
+        return mState == PACING_STATE_PREROLL || mState == PACING_STATE_PLAYING;
+    };
+    static const char *stateName(int state);
+    static const char *eventName(int event);
+  private:
+    int frameState() {
+        return mPrerolled? PACING_STATE_PLAYING : PACING_STATE_PREROLL;
+    };
+    int mState;
+    bool mPaused;
+    bool mPrerolled;
+};
+
+#endif /*__PACING_STATE_H__*/
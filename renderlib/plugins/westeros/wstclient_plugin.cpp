@@ -6,10 +6,12 @@
  *
  * Description:
  */
+#include <string.h>
 #include <linux/videodev2.h>
 #include "wstclient_wayland.h"
 #include "wstclient_plugin.h"
 #include "Logger.h"
+#include "Times.h"
 
 #define TAG "rlib:wstClient_plugin"
 
@@ -24,6 +26,8 @@ WstClientPlugin::WstClientPlugin(int logCategory)
     mBufferFormat = VIDEO_FORMAT_UNKNOWN;
     mNumDroppedFrames = 0;
     mCommitFrameCnt = 0;
+    mFrameSeq = 0;
+    memset(mInflightFrames, 0, sizeof(mInflightFrames));
     mWayland = new WstClientWayland(this, logCategory);
     mWstClientSocket = NULL;
     mKeepLastFrame.isSet = false;
@@ -55,6 +59,8 @@ void WstClientPlugin::release()
 
 void WstClientPlugin::setUserData(void *userData, PluginCallback *callback)
 {
+    //socket thread calls back under mMutex
+    Tls::Mutex::Autolock _l(mMutex);
     mUserData = userData;
     mCallback = callback;
 }
@@ -135,7 +141,7 @@ int WstClientPlugin::openWindow()
 
 int WstClientPlugin::displayFrame(RenderBuffer *buffer, int64_t displayTime)
 {
-    bool ret;
+    int ret;
     WstBufferInfo wstBufferInfo;
     WstRect wstRect;
     int x,y,w,h;
@@ -150,7 +156,24 @@ int WstClientPlugin::displayFrame(RenderBuffer *buffer, int64_t displayTime)
         wstBufferInfo.planeInfo[2].fd = -1;
     }
 
-    wstBufferInfo.bufferId = buffer->id;
+    //reserve a slot before sending,server may release it at once
+    mRenderLock.lock();
+    InflightFrame *frame = &mInflightFrames[mFrameSeq & (WST_MAX_INFLIGHT_FRAMES - 1)];
+    if (frame->state != FRAME_FREE) {
+        mRenderLock.unlock();
+        TRACE1(mLogCategory,"in-flight frames reach max %d",WST_MAX_INFLIGHT_FRAMES);
+        return ERROR_WOULD_BLOCK;
+    }
+    frame->buffer = buffer;
+    frame->seq = mFrameSeq;
+    frame->displayTime = displayTime;
+    frame->submitTime = Tls::Times::getSystemTimeUs();
+    frame->state = FRAME_COMMITTED;
+    mFrameSeq = (mFrameSeq + 1) & 0x7FFFFFFF;
+    ++mCommitFrameCnt;
+    mRenderLock.unlock();
+
+    wstBufferInfo.bufferId = frame->seq;
     wstBufferInfo.planeCount = buffer->dma.planeCnt;
     for (int i = 0; i < buffer->dma.planeCnt; i++) {
         wstBufferInfo.planeInfo[i].fd = buffer->dma.fd[i];
@@ -179,26 +202,27 @@ int WstClientPlugin::displayFrame(RenderBuffer *buffer, int64_t displayTime)
 
     if (mWstClientSocket) {
         ret = mWstClientSocket->sendFrameVideoClientConnection(&wstBufferInfo, &wstRect);
-        if (!ret) {
+        if (ret != NO_ERROR) {
+            //free the reserved slot,server had not got this frame
+            mRenderLock.lock();
+            frame->state = FRAME_FREE;
+            frame->buffer = NULL;
+            --mCommitFrameCnt;
+            mRenderLock.unlock();
+        }
+        if (ret == ERROR_WOULD_BLOCK) {
+            //server is slow to drain socket,buffer is not taken,
+            //render core will hold or drop it
+            return ERROR_WOULD_BLOCK;
+        } else if (ret != NO_ERROR) {
             ERROR(mLogCategory,"send video frame to server fail");
             handleFrameDropped(buffer);
             handleBufferRelease(buffer);
             return ERROR_FAILED_TRANSACTION;
         }
     }
-
-    //storage render buffer to manager
-    mRenderLock.lock();
-    std::pair<int, RenderBuffer *> item(buffer->id, buffer);
-    mRenderBuffersMap.insert(item);
-    ++mCommitFrameCnt;
     TRACE1(mLogCategory,"commit to westeros cnt:%d",mCommitFrameCnt);
 
-    //storage displayed render buffer
-    std::pair<int, int64_t> displayitem(buffer->id, displayTime);
-    mDisplayedFrameMap.insert(displayitem);
-    mRenderLock.unlock();
-
     return NO_ERROR;
 }
 
@@ -209,20 +233,17 @@ int WstClientPlugin::flush()
     if (mWstClientSocket) {
         mWstClientSocket->sendFlushVideoClientConnection();
     }
-    //drop frames those had commited to westeros
+    //drop frames those had commited to westeros but not displayed,
+    //they are released when server releases them,flush does not wait
     std::lock_guard<std::mutex> lck(mRenderLock);
-    for (auto item = mDisplayedFrameMap.begin(); item != mDisplayedFrameMap.end(); ) {
-        int bufferid = (int)item->first;
-        auto bufItem = mRenderBuffersMap.find(bufferid);
-        if (bufItem == mRenderBuffersMap.end()) {
-            continue;
-        }
-        mDisplayedFrameMap.erase(item++);
-        RenderBuffer *renderbuffer = (RenderBuffer*) bufItem->second;
-        if (renderbuffer) {
-            handleFrameDropped(renderbuffer);
+    for (int i = 0; i < WST_MAX_INFLIGHT_FRAMES; i++) {
+        InflightFrame *frame = &mInflightFrames[i];
+        if (frame->state == FRAME_COMMITTED) {
+            frame->state = FRAME_DROPPED;
+            handleFrameDropped(frame->buffer);
         }
     }
+    TRACE1(mLogCategory,"flush,%d frames wait server releasing",getUndisplayedFrameCnt());
 
     return NO_ERROR;
 }
@@ -265,29 +286,20 @@ int WstClientPlugin::closeWindow()
     }
 
     std::lock_guard<std::mutex> lck(mRenderLock);
-    //drop all frames those don't displayed
-    for (auto item = mDisplayedFrameMap.begin(); item != mDisplayedFrameMap.end(); ) {
-        int bufferid = (int)item->first;
-        auto bufItem = mRenderBuffersMap.find(bufferid);
-        if (bufItem == mRenderBuffersMap.end()) {
+    for (int i = 0; i < WST_MAX_INFLIGHT_FRAMES; i++) {
+        InflightFrame *frame = &mInflightFrames[i];
+        if (frame->state == FRAME_FREE) {
             continue;
         }
-        mDisplayedFrameMap.erase(item++);
-        RenderBuffer *renderbuffer = (RenderBuffer*) bufItem->second;
-        if (renderbuffer) {
-            handleFrameDropped(renderbuffer);
+        //drop all frames those don't displayed
+        if (frame->state == FRAME_COMMITTED) {
+            handleFrameDropped(frame->buffer);
         }
+        //release all frames those had commited to westeros server
+        handleBufferRelease(frame->buffer);
+        frame->state = FRAME_FREE;
+        frame->buffer = NULL;
     }
-    //release all frames those had commited to westeros server
-    for (auto item = mRenderBuffersMap.begin(); item != mRenderBuffersMap.end();) {
-        RenderBuffer *renderbuffer = (RenderBuffer*) item->second;
-        mRenderBuffersMap.erase(item++);
-        if (renderbuffer) {
-            handleBufferRelease(renderbuffer);
-        }
-    }
-    mRenderBuffersMap.clear();
-    mDisplayedFrameMap.clear();
     mCommitFrameCnt = 0;
     mNumDroppedFrames = 0;
     return NO_ERROR;
@@ -413,34 +425,37 @@ void WstClientPlugin::onWstSocketEvent(WstEvent *event)
         case WST_REFRESH_RATE: {
             int rate = event->param;
             INFO(mLogCategory,"refresh rate:%d",rate);
+            if (mCallback && rate > 0) {
+                //video server reports rate in Hz
+                PluginDisplayMode mode;
+                mode.width = 0;
+                mode.height = 0;
+                mode.refreshRate = rate * 1000;
+                mCallback->doSendMsgCallback(mUserData, PLUGIN_MSG_DISPLAY_MODE_CHANGED, &mode);
+            }
         } break;
         case WST_BUFFER_RELEASE: {
-            int bufferid = event->param;
-            TRACE2(mLogCategory,"Buffer release id:%d",bufferid);
+            int seq = event->param;
+            TRACE2(mLogCategory,"Buffer release id:%d",seq);
             std::lock_guard<std::mutex> lck(mRenderLock);
-            auto item = mRenderBuffersMap.find(bufferid);
-            if (item == mRenderBuffersMap.end()) {
-                WARNING(mLogCategory,"can't find map Renderbuffer");
+            InflightFrame *frame = getInflightFrame(seq);
+            if (!frame) {
+                WARNING(mLogCategory,"can't find in-flight frame %d",seq);
                 return ;
             }
 
             --mCommitFrameCnt;
-            RenderBuffer *renderbuffer = (RenderBuffer*) item->second;
-            //remove had release render buffer
-            mRenderBuffersMap.erase(bufferid);
-
-            if (renderbuffer) {
-                /*if we can find item in mDisplayedFrameMap,
-                this buffer is dropped by westeros server,so we
-                must call displayed callback*/
-                auto displayFrameItem = mDisplayedFrameMap.find(bufferid);
-                if (displayFrameItem != mDisplayedFrameMap.end()) {
-                    mDisplayedFrameMap.erase(bufferid);
-                    WARNING(mLogCategory,"Frame droped,pts:%lld,displaytime:%lld",renderbuffer->pts,(int64_t)displayFrameItem->second);
-                    handleFrameDropped(renderbuffer);
-                }
-                handleBufferRelease(renderbuffer);
+            RenderBuffer *renderbuffer = frame->buffer;
+            /*if frame is not displayed,this buffer is dropped
+            by westeros server,so we must call dropped callback*/
+            if (frame->state == FRAME_COMMITTED) {
+                WARNING(mLogCategory,"Frame droped,pts:%lld,displaytime:%lld",renderbuffer->pts,frame->displayTime);
+                handleFrameDropped(renderbuffer);
             }
+            //remove had release render buffer
+            frame->state = FRAME_FREE;
+            frame->buffer = NULL;
+            handleBufferRelease(renderbuffer);
             TRACE1(mLogCategory,"commit to westeros cnt:%d",mCommitFrameCnt);
         } break;
         case WST_STATUS: {
@@ -454,22 +469,23 @@ void WstClientPlugin::onWstSocketEvent(WstEvent *event)
             //this buffer had displayed
             if (frameTime != -1LL) {
                 std::lock_guard<std::mutex> lck(mRenderLock);
-                int bufferId = getDisplayFrameBufferId(frameTime);
-                if (bufferId < 0) {
+                InflightFrame *frame = getDisplayFrame(frameTime);
+                if (!frame) {
                     WARNING(mLogCategory,"can't find map displayed frame:%lld",frameTime);
                     return ;
                 }
-                auto displayItem = mDisplayedFrameMap.find(bufferId);
-                if (displayItem != mDisplayedFrameMap.end()) {
-                    mDisplayedFrameMap.erase(bufferId);
-                }
-                auto item = mRenderBuffersMap.find(bufferId);
-                if (item != mRenderBuffersMap.end()) {
-                    RenderBuffer *renderbuffer = (RenderBuffer*) item->second;
-                    if (renderbuffer) {
-                        handleFrameDisplayed(renderbuffer);
-                    }
+                frame->state = FRAME_DISPLAYED;
+                //use presentation time reported by server,servers not
+                //reporting it send status when frame is presented
+                if (mCallback) {
+                    PluginFramePresented presented;
+                    presented.buffer = frame->buffer;
+                    presented.displayTimeUs = frame->displayTime;
+                    presented.submitTimeUs = frame->submitTime;
+                    presented.presentedTimeUs = event->lparam1 > 0? event->lparam1 : Tls::Times::getSystemTimeUs();
+                    mCallback->doSendMsgCallback(mUserData, PLUGIN_MSG_FRAME_PRESENTED, &presented);
                 }
+                handleFrameDisplayed(frame->buffer);
             }
         } break;
         case WST_UNDERFLOW: {
@@ -489,15 +505,35 @@ void WstClientPlugin::onWstSocketEvent(WstEvent *event)
     }
 }
 
-int WstClientPlugin::getDisplayFrameBufferId(int64_t displayTime)
+WstClientPlugin::InflightFrame *WstClientPlugin::getDisplayFrame(int64_t displayTime)
 {
-    int bufId = -1;
-    for (auto item = mDisplayedFrameMap.begin(); item != mDisplayedFrameMap.end(); item++) {
-        int64_t time = (int64_t)item->second;
-        if (time == displayTime) {
-            bufId = (int)item->first;
-            break;
+    //scan from the oldest frame,at most WST_MAX_INFLIGHT_FRAMES slots
+    for (int i = WST_MAX_INFLIGHT_FRAMES; i > 0; i--) {
+        InflightFrame *frame = &mInflightFrames[(mFrameSeq - i) & (WST_MAX_INFLIGHT_FRAMES - 1)];
+        if (frame->state == FRAME_COMMITTED && frame->displayTime == displayTime) {
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+WstClientPlugin::InflightFrame *WstClientPlugin::getInflightFrame(int seq)
+{
+    InflightFrame *frame = &mInflightFrames[seq & (WST_MAX_INFLIGHT_FRAMES - 1)];
+    if (frame->state == FRAME_FREE || frame->seq != seq) {
+        return NULL;
+    }
+    return frame;
+}
+
+int WstClientPlugin::getUndisplayedFrameCnt()
+{
+    int cnt = 0;
+    for (int i = 0; i < WST_MAX_INFLIGHT_FRAMES; i++) {
+        if (mInflightFrames[i].state == FRAME_COMMITTED ||
+            mInflightFrames[i].state == FRAME_DROPPED) {
+            cnt++;
         }
     }
-    return bufId;
+    return cnt;
 }
\ No newline at end of file
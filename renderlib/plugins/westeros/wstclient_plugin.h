@@ -13,6 +13,10 @@
 #include "wstclient_socket.h"
 #include <mutex>
 
+/*max frames outstanding at westeros server,it is the buffer
+limit of westeros video server,must be power of 2*/
+#define WST_MAX_INFLIGHT_FRAMES (16)
+
 class WstClientPlugin : public RenderPlugin
 {
   public:
@@ -49,13 +53,40 @@ class WstClientPlugin : public RenderPlugin
         bool isSet;
         bool value;
     } ConfigValue;
+    typedef enum {
+        FRAME_FREE = 0,
+        FRAME_COMMITTED, //sent to server,not displayed
+        FRAME_DISPLAYED, //displayed,wait server release
+        FRAME_DROPPED, //dropped by flush,wait server release
+    } FrameState;
+    typedef struct {
+        RenderBuffer *buffer;
+        int seq; //frame sequence,it is the buffer id sent to server
+        int64_t displayTime;
+        int64_t submitTime; //systemtime us of sending to server
+        FrameState state;
+    } InflightFrame;
     /**
-     * @brief Get the Display Frame Buffer Id object
+     * @brief Get the in-flight frame that is committed
+     * with the display time
      *
      * @param displayTime
-     * @return int > 0 if sucess, -1 if not found
+     * @return InflightFrame* or NULL if not found
+     */
+    InflightFrame *getDisplayFrame(int64_t displayTime);
+    /**
+     * @brief Get the in-flight frame of frame sequence
+     *
+     * @param seq frame sequence got from server
+     * @return InflightFrame* or NULL if not found
+     */
+    InflightFrame *getInflightFrame(int seq);
+    /**
+     * @brief count frames those are not displayed,but
+     * server had not released
+     * @return int the frame count
      */
-    int getDisplayFrameBufferId(int64_t displayTime);
+    int getUndisplayedFrameCnt();
     PluginCallback *mCallback;
     WstClientWayland *mWayland;
     WstClientSocket *mWstClientSocket;
@@ -73,9 +104,9 @@ class WstClientPlugin : public RenderPlugin
     int mCommitFrameCnt; //the count frames of commiting to server
 
     RenderVideoFormat mBufferFormat;
-    std::unordered_map<int, RenderBuffer *> mRenderBuffersMap;
-    /*key is buffer id, value is display time*/
-    std::unordered_map<int, int64_t> mDisplayedFrameMap;
+    /*in-flight frames,the slot of a frame is seq % WST_MAX_INFLIGHT_FRAMES*/
+    InflightFrame mInflightFrames[WST_MAX_INFLIGHT_FRAMES];
+    int mFrameSeq; //next frame sequence
 
     bool mIsVideoPip;
     mutable Tls::Mutex mMutex;
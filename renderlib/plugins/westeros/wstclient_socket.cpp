@@ -8,6 +8,7 @@
  */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <stddef.h>
 #include <sys/time.h>
 #include <stdarg.h>
@@ -23,6 +24,8 @@
 #include "wstclient_plugin.h"
 #include "Logger.h"
 #include "Utils.h"
+#include "ErrorCode.h"
+#include "Times.h"
 
 #define TAG "rlib:wstclient_socket"
 
@@ -31,6 +34,14 @@ WstClientSocket::WstClientSocket(WstClientPlugin *plugin, int logCategory)
     mLogCategory = logCategory;
     mPlugin = plugin;
     mPoll = new Tls::Poll(true);
+    mPendingFrameCnt = 0;
+    mDirtyControls = 0;
+    mDirtySinceUs = 0;
+    mControlPause = false;
+    mControlHide = false;
+    mControlFpsNum = 0;
+    mControlFpsDenom = 0;
+    memset(&mControlRect, 0, sizeof(WstRect));
 }
 
 WstClientSocket::~WstClientSocket()
@@ -89,6 +100,14 @@ bool WstClientSocket::connectToSocket(const char *name)
         goto exit;
     }
 
+    //display thread must never block on westeros server
+    rc = fcntl(mSocketFd, F_GETFL, 0);
+    if ( rc < 0 || fcntl(mSocketFd, F_SETFL, rc | O_NONBLOCK) < 0 )
+    {
+        ERROR(mLogCategory,"wstCreateVideoClientConnection: set socket nonblock fail: errno %d", errno );
+        goto exit;
+    }
+
     INFO(mLogCategory,"wstclient socket connected,path:%s",mAddr.sun_path);
 
     run("wstclientsocket");
@@ -115,6 +134,14 @@ bool WstClientSocket::disconnectFromSocket()
         requestExitAndWait();
     }
 
+    mSendMutex.lock();
+    while (!mPendingMsgs.empty()) {
+        closePendingFds(&mPendingMsgs.front());
+        mPendingMsgs.pop_front();
+    }
+    mPendingFrameCnt = 0;
+    mSendMutex.unlock();
+
     if ( mSocketFd >= 0 )
     {
         mAddr.sun_path[0]= '\0';
@@ -127,19 +154,9 @@ bool WstClientSocket::disconnectFromSocket()
 
 void WstClientSocket::sendLayerVideoClientConnection(bool pip)
 {
-    struct msghdr msg;
-    struct iovec iov[1];
     unsigned char mbody[5];
     int len;
-    int sentLen;
-
-    msg.msg_name= NULL;
-    msg.msg_namelen= 0;
-    msg.msg_iov= iov;
-    msg.msg_iovlen= 1;
-    msg.msg_control= 0;
-    msg.msg_controllen= 0;
-    msg.msg_flags= 0;
+    int ret;
 
     len= 0;
     mbody[len++]= 'V';
@@ -148,16 +165,9 @@ void WstClientSocket::sendLayerVideoClientConnection(bool pip)
     mbody[len++]= 'N';
     mbody[len++]= (pip? 1 : 0);
 
-    iov[0].iov_base= (char*)mbody;
-    iov[0].iov_len= len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen= sendmsg(mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent pip %d to video server", pip);
     }
@@ -165,21 +175,11 @@ void WstClientSocket::sendLayerVideoClientConnection(bool pip)
 
 void WstClientSocket::sendResourceVideoClientConnection(bool pip)
 {
-    struct msghdr msg;
-    struct iovec iov[1];
     unsigned char mbody[8];
     int len;
-    int sentLen;
+    int ret;
     int resourceId= (pip? 1 : 0);
 
-    msg.msg_name= NULL;
-    msg.msg_namelen= 0;
-    msg.msg_iov= iov;
-    msg.msg_iovlen= 1;
-    msg.msg_control= 0;
-    msg.msg_controllen= 0;
-    msg.msg_flags= 0;
-
     len= 0;
     mbody[len++]= 'V';
     mbody[len++]= 'S';
@@ -187,16 +187,9 @@ void WstClientSocket::sendResourceVideoClientConnection(bool pip)
     mbody[len++]= 'V';
     len += putU32( &mbody[len], resourceId );
 
-    iov[0].iov_base= (char*)mbody;
-    iov[0].iov_len= len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen= sendmsg(mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent resource id %d (0:primary,1:pip) to video server", resourceId);
     }
@@ -204,19 +197,9 @@ void WstClientSocket::sendResourceVideoClientConnection(bool pip)
 
 void WstClientSocket::sendFlushVideoClientConnection()
 {
-    struct msghdr msg;
-    struct iovec iov[1];
     unsigned char mbody[4];
     int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
+    int ret;
 
     len = 0;
     mbody[len++] = 'V';
@@ -224,16 +207,9 @@ void WstClientSocket::sendFlushVideoClientConnection()
     mbody[len++] = 1;
     mbody[len++] = 'S';
 
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent flush to video server");
     }
@@ -241,95 +217,23 @@ void WstClientSocket::sendFlushVideoClientConnection()
 
 void WstClientSocket::sendPauseVideoClientConnection(bool pause)
 {
-    struct msghdr msg;
-    struct iovec iov[1];
-    unsigned char mbody[7];
-    int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
-
-    len= 0;
-    mbody[len++] = 'V';
-    mbody[len++] = 'S';
-    mbody[len++] = 2;
-    mbody[len++] = 'P';
-    mbody[len++] = (pause ? 1 : 0);
-
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
-
-    do
-    {
-        sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
-    {
-        INFO(mLogCategory,"sent pause %d to video server", pause);
-    }
+    Tls::Mutex::Autolock _l(mControlMutex);
+    mControlPause = pause;
+    markControlDirty(WST_CONTROL_PAUSE);
 }
 
 void WstClientSocket::sendHideVideoClientConnection(bool hide)
 {
-    struct msghdr msg;
-    struct iovec iov[1];
-    unsigned char mbody[7];
-    int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
-
-    len= 0;
-    mbody[len++] = 'V';
-    mbody[len++] = 'S';
-    mbody[len++] = 2;
-    mbody[len++] = 'H';
-    mbody[len++] = (hide ? 1 : 0);
-
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
-
-    do
-    {
-        sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
-    {
-        INFO(mLogCategory,"sent hide %d to video server", hide);
-    }
+    Tls::Mutex::Autolock _l(mControlMutex);
+    mControlHide = hide;
+    markControlDirty(WST_CONTROL_HIDE);
 }
 
 void WstClientSocket::sendSessionInfoVideoClientConnection(int sessionId, int syncType )
 {
-    struct msghdr msg;
-    struct iovec iov[1];
     unsigned char mbody[9];
     int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
+    int ret;
 
     len= 0;
     mbody[len++] = 'V';
@@ -339,16 +243,9 @@ void WstClientSocket::sendSessionInfoVideoClientConnection(int sessionId, int sy
     mbody[len++] = syncType;
     len += putU32( &mbody[len], sessionId );
 
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent session info: synctype %d sessionId %d to video server", syncType, sessionId);
     }
@@ -356,19 +253,9 @@ void WstClientSocket::sendSessionInfoVideoClientConnection(int sessionId, int sy
 
 void WstClientSocket::sendFrameAdvanceVideoClientConnection()
 {
-    struct msghdr msg;
-    struct iovec iov[1];
     unsigned char mbody[4];
     int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
+    int ret;
 
     len= 0;
     mbody[len++] = 'V';
@@ -376,16 +263,9 @@ void WstClientSocket::sendFrameAdvanceVideoClientConnection()
     mbody[len++] = 1;
     mbody[len++] = 'A';
 
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen= sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent frame adavnce to video server");
     }
@@ -393,102 +273,133 @@ void WstClientSocket::sendFrameAdvanceVideoClientConnection()
 
 void WstClientSocket::sendRectVideoClientConnection(int videoX, int videoY, int videoWidth, int videoHeight )
 {
-    struct msghdr msg;
-    struct iovec iov[1];
-    unsigned char mbody[20];
-    int len;
-    int sentLen;
-    int vx, vy, vw, vh;
-
-    vx = videoX;
-    vy = videoY;
-    vw = videoWidth;
-    vh = videoHeight;
+    Tls::Mutex::Autolock _l(mControlMutex);
+    mControlRect.x = videoX;
+    mControlRect.y = videoY;
+    mControlRect.w = videoWidth;
+    mControlRect.h = videoHeight;
+    markControlDirty(WST_CONTROL_RECT);
+}
 
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
+void WstClientSocket::sendRateVideoClientConnection(int fpsNum, int fpsDenom )
+{
+    Tls::Mutex::Autolock _l(mControlMutex);
+    mControlFpsNum = fpsNum;
+    mControlFpsDenom = fpsDenom;
+    markControlDirty(WST_CONTROL_RATE);
+}
 
-    len = 0;
-    mbody[len++] = 'V';
-    mbody[len++] = 'S';
-    mbody[len++] = 17;
-    mbody[len++] = 'W';
-    len += putU32( &mbody[len], vx );
-    len += putU32( &mbody[len], vy );
-    len += putU32( &mbody[len], vw );
-    len += putU32( &mbody[len], vh );
+void WstClientSocket::markControlDirty(int control)
+{
+    if (mDirtyControls == 0) {
+        mDirtySinceUs = Tls::Times::getSystemTimeUs();
+        //socket thread must recompute its flush deadline
+        mPoll->wakeup();
+    }
+    mDirtyControls |= control;
+}
 
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
+int WstClientSocket::buildControlMessages(unsigned char *mbody)
+{
+    int len = 0;
+
+    if (mDirtyControls & WST_CONTROL_RECT) {
+        mbody[len++] = 'V';
+        mbody[len++] = 'S';
+        mbody[len++] = 17;
+        mbody[len++] = 'W';
+        len += putU32( &mbody[len], mControlRect.x );
+        len += putU32( &mbody[len], mControlRect.y );
+        len += putU32( &mbody[len], mControlRect.w );
+        len += putU32( &mbody[len], mControlRect.h );
+    }
+    if (mDirtyControls & WST_CONTROL_RATE) {
+        mbody[len++] = 'V';
+        mbody[len++] = 'S';
+        mbody[len++] = 9;
+        mbody[len++] = 'R';
+        len += putU32( &mbody[len], mControlFpsNum );
+        len += putU32( &mbody[len], mControlFpsDenom );
+    }
+    if (mDirtyControls & WST_CONTROL_PAUSE) {
+        mbody[len++] = 'V';
+        mbody[len++] = 'S';
+        mbody[len++] = 2;
+        mbody[len++] = 'P';
+        mbody[len++] = (mControlPause ? 1 : 0);
+    }
+    if (mDirtyControls & WST_CONTROL_HIDE) {
+        mbody[len++] = 'V';
+        mbody[len++] = 'S';
+        mbody[len++] = 2;
+        mbody[len++] = 'H';
+        mbody[len++] = (mControlHide ? 1 : 0);
+    }
+    return len;
+}
 
-    do
-    {
-        sentLen= sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
+void WstClientSocket::onControlMessagesSent()
+{
+    if (mDirtyControls & WST_CONTROL_RECT) {
+        INFO(mLogCategory,"sent position to video server,vx:%d,vy:%d,vw:%d,vh:%d",
+            mControlRect.x,mControlRect.y,mControlRect.w,mControlRect.h);
     }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
-    {
-        INFO(mLogCategory,"sent position to video server,vx:%d,vy:%d,vw:%d,vh:%d",videoX,videoY,videoWidth,videoHeight);
+    if (mDirtyControls & WST_CONTROL_RATE) {
+        INFO(mLogCategory,"sent frame rate to video server: %d/%d", mControlFpsNum, mControlFpsDenom);
+    }
+    if (mDirtyControls & WST_CONTROL_PAUSE) {
+        INFO(mLogCategory,"sent pause %d to video server", mControlPause);
     }
+    if (mDirtyControls & WST_CONTROL_HIDE) {
+        INFO(mLogCategory,"sent hide %d to video server", mControlHide);
+    }
+    mDirtyControls = 0;
 }
 
-void WstClientSocket::sendRateVideoClientConnection(int fpsNum, int fpsDenom )
+void WstClientSocket::flushControlMessages(bool force)
 {
-    struct msghdr msg;
-    struct iovec iov[1];
-    unsigned char mbody[12];
+    unsigned char mbody[WST_MAX_MSG_LEN];
     int len;
-    int sentLen;
-
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
-
-    len = 0;
-    mbody[len++] = 'V';
-    mbody[len++] = 'S';
-    mbody[len++] = 9;
-    mbody[len++] = 'R';
-    len += putU32( &mbody[len], fpsNum );
-    len += putU32( &mbody[len], fpsDenom );
-
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
 
-    do
-    {
-        sentLen= sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
+    Tls::Mutex::Autolock _l(mControlMutex);
+    if (mDirtyControls == 0) {
+        return;
     }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
-    {
-        INFO(mLogCategory,"sent frame rate to video server: %d/%d", fpsNum, fpsDenom);
+    if (!force && Tls::Times::getSystemTimeUs() < mDirtySinceUs + WST_CONTROL_FLUSH_TIME_US) {
+        return;
+    }
+    len = buildControlMessages(mbody);
+    if (queueMessage(mbody, len, NULL, 0, false) == NO_ERROR) {
+        onControlMessagesSent();
     }
 }
 
-bool WstClientSocket::sendFrameVideoClientConnection(WstBufferInfo *wstBufferInfo, WstRect *wstRect)
+int WstClientSocket::queueOrderedMessage(unsigned char *body, int len)
 {
-    bool result= false;
-    int sentLen;
+    unsigned char mbody[WST_MAX_MSG_LEN];
+    int i;
+    int ret;
 
-    struct msghdr msg;
-    struct cmsghdr *cmsg;
-    struct iovec iov[1];
-    unsigned char mbody[4+64];
-    char cmbody[CMSG_SPACE(3*sizeof(int))];
-    int i, len;
-    int *fd;
+    //deferred control changes were requested before this message,
+    //they go first in the same message so server sees them in order
+    Tls::Mutex::Autolock _l(mControlMutex);
+    i = buildControlMessages(mbody);
+    memcpy(&mbody[i], body, len);
+    i += len;
+    ret = queueMessage(mbody, i, NULL, 0, false);
+    if (ret == NO_ERROR) {
+        onControlMessagesSent();
+    }
+    return ret;
+}
+
+int WstClientSocket::sendFrameVideoClientConnection(WstBufferInfo *wstBufferInfo, WstRect *wstRect)
+{
+    int result= ERROR_BAD_VALUE;
+
+    unsigned char mbody[WST_MAX_MSG_LEN];
+    int i;
+    int fd[WST_MAX_PLANES];
     int numFdToSend;
     int frameFd0 = -1, frameFd1 = -1, frameFd2 = -1;
     int fdToSend0 = -1, fdToSend1 = -1, fdToSend2 = -1;
@@ -573,7 +484,10 @@ bool WstClientSocket::sendFrameVideoClientConnection(WstBufferInfo *wstBufferInf
 
         DEBUG(mLogCategory,"send frame:x:%d,y:%d,w:%d,h:%d", vx, vy, vw, vh);
 
-        i = 0;
+        //pending control changes go in the same message before
+        //the frame,so they land on this frame
+        mControlMutex.lock();
+        i = buildControlMessages(mbody);
         mbody[i++] = 'V';
         mbody[i++] = 'S';
         mbody[i++] = 65;
@@ -594,45 +508,32 @@ bool WstClientSocket::sendFrameVideoClientConnection(WstBufferInfo *wstBufferInf
         i += putU32( &mbody[i], bufferId );
         i += putS64( &mbody[i], wstBufferInfo->frameTime );
 
-        iov[0].iov_base = (char*)mbody;
-        iov[0].iov_len = i;
-
-        cmsg = (struct cmsghdr*)cmbody;
-        cmsg->cmsg_len = CMSG_LEN(numFdToSend*sizeof(int));
-        cmsg->cmsg_level = SOL_SOCKET;
-        cmsg->cmsg_type = SCM_RIGHTS;
-
-        msg.msg_name = NULL;
-        msg.msg_namelen = 0;
-        msg.msg_iov = iov;
-        msg.msg_iovlen = 1;
-        msg.msg_control = cmsg;
-        msg.msg_controllen = cmsg->cmsg_len;
-        msg.msg_flags = 0;
-
-        fd = (int*)CMSG_DATA(cmsg);
-        fd[0] = fdToSend0;
+        numFdToSend = 0;
+        fd[numFdToSend++] = fdToSend0;
         if ( fdToSend1 >= 0 )
         {
-            fd[1] = fdToSend1;
+            fd[numFdToSend++] = fdToSend1;
         }
         if ( fdToSend2 >= 0 )
         {
-            fd[2] = fdToSend2;
+            fd[numFdToSend++] = fdToSend2;
         }
 
         DEBUG(mLogCategory,"send frame:bufferid %d, fd (%d, %d, %d [%d, %d, %d]),realtmUs:%lld", bufferId, frameFd0, frameFd1, frameFd2, fdToSend0, fdToSend1, fdToSend2,wstBufferInfo->frameTime);
 
-        do
+        //dup fds are owned by outbound queue now
+        fdToSend0 = fdToSend1 = fdToSend2 = -1;
+        result = queueMessage(mbody, i, fd, numFdToSend, true);
+        if ( result == NO_ERROR )
         {
-            sentLen = sendmsg( mSocketFd, &msg, 0 );
-        } while ( (sentLen < 0) && (errno == EINTR));
-
-        if ( sentLen == iov[0].iov_len )
+            onControlMessagesSent();
+        }
+        mControlMutex.unlock();
+        if ( result == ERROR_WOULD_BLOCK )
         {
-            result = true;
+            TRACE1(mLogCategory,"server busy, frame %lld buffer %d not taken", wstBufferInfo->frameTime, bufferId);
         }
-        else
+        else if ( result != NO_ERROR )
         {
             DEBUG(mLogCategory,"out: failed send frame %lld buffer %d ", wstBufferInfo->frameTime, bufferId);
         }
@@ -655,21 +556,149 @@ exit:
    return result;
 }
 
-void WstClientSocket::sendKeepLastFrameVideoClientConnection(bool keep)
+void WstClientSocket::closePendingFds(PendingMsg *pending)
+{
+    for (int i = 0; i < pending->numFds; i++) {
+        if (pending->fds[i] >= 0) {
+            close(pending->fds[i]);
+            pending->fds[i] = -1;
+        }
+    }
+    pending->numFds = 0;
+}
+
+int WstClientSocket::queueMessage(unsigned char *body, int len, int *fds, int numFds, bool isFrame)
+{
+    PendingMsg *pending;
+    int ret;
+
+    Tls::Mutex::Autolock _l(mSendMutex);
+    if (mSocketFd < 0) {
+        for (int i = 0; i < numFds; i++) {
+            close(fds[i]);
+        }
+        return ERROR_NO_INIT;
+    }
+
+    //refuse frame,caller decides to hold or drop it,control
+    //messages are ordered and never dropped,queue grows for them
+    if (isFrame && (mPendingFrameCnt >= WST_MAX_PENDING_FRAMES ||
+        (int)mPendingMsgs.size() >= WST_MAX_PENDING_MSGS)) {
+        for (int i = 0; i < numFds; i++) {
+            close(fds[i]);
+        }
+        return ERROR_WOULD_BLOCK;
+    }
+    if ((int)mPendingMsgs.size() >= WST_MAX_PENDING_MSGS) {
+        WARNING(mLogCategory,"outbound queue full,grow for msg %c,pending:%d",body[3],(int)mPendingMsgs.size());
+    }
+
+    //references to queued msgs stay valid when deque grows at ends
+    mPendingMsgs.push_back(PendingMsg());
+    pending = &mPendingMsgs.back();
+    memcpy(pending->body, body, len);
+    pending->len = len;
+    pending->sentLen = 0;
+    pending->numFds = numFds;
+    for (int i = 0; i < numFds; i++) {
+        pending->fds[i] = fds[i];
+    }
+    pending->isFrame = isFrame;
+    if (isFrame) {
+        mPendingFrameCnt++;
+    }
+
+    ret = drainPendingMessages(pending);
+
+    //socket is full,let socket thread send the left when writable
+    if (!mPendingMsgs.empty()) {
+        TRACE2(mLogCategory,"socket busy,pending msgs:%d,frames:%d",(int)mPendingMsgs.size(),mPendingFrameCnt);
+        mPoll->setFdWritable(mSocketFd, true);
+        mPoll->wakeup();
+    }
+    return ret;
+}
+
+int WstClientSocket::drainPendingMessages(PendingMsg *own)
 {
     struct msghdr msg;
+    struct cmsghdr *cmsg;
     struct iovec iov[1];
-    unsigned char mbody[7];
-    int len;
+    char cmbody[CMSG_SPACE(WST_MAX_PLANES*sizeof(int))];
+    PendingMsg *pending;
     int sentLen;
 
-    msg.msg_name = NULL;
-    msg.msg_namelen = 0;
-    msg.msg_iov = iov;
-    msg.msg_iovlen = 1;
-    msg.msg_control = 0;
-    msg.msg_controllen = 0;
-    msg.msg_flags = 0;
+    while (!mPendingMsgs.empty()) {
+        pending = &mPendingMsgs.front();
+
+        iov[0].iov_base = (char*)pending->body + pending->sentLen;
+        iov[0].iov_len = pending->len - pending->sentLen;
+
+        msg.msg_name = NULL;
+        msg.msg_namelen = 0;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = 0;
+        msg.msg_controllen = 0;
+        msg.msg_flags = 0;
+
+        //fds are passed with the first byte of message
+        if (pending->numFds > 0) {
+            cmsg = (struct cmsghdr*)cmbody;
+            cmsg->cmsg_len = CMSG_LEN(pending->numFds*sizeof(int));
+            cmsg->cmsg_level = SOL_SOCKET;
+            cmsg->cmsg_type = SCM_RIGHTS;
+            memcpy(CMSG_DATA(cmsg), pending->fds, pending->numFds*sizeof(int));
+            msg.msg_control = cmsg;
+            msg.msg_controllen = cmsg->cmsg_len;
+        }
+
+        do
+        {
+            sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL|MSG_DONTWAIT );
+        } while ( (sentLen < 0) && (errno == EINTR));
+
+        if (sentLen < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return NO_ERROR;
+            }
+            ERROR(mLogCategory,"send msg %c fail,errno:%d",pending->body[3],errno);
+            //drop this msg,peer maybe closed
+            sentLen = pending->len - pending->sentLen;
+            closePendingFds(pending);
+            pending->sentLen += sentLen;
+            if (pending->isFrame) {
+                mPendingFrameCnt--;
+            }
+            //failure of an earlier msg is not the caller's,it was logged
+            if (pending == own) {
+                mPendingMsgs.pop_front();
+                return ERROR_FAILED_TRANSACTION;
+            }
+            mPendingMsgs.pop_front();
+            continue;
+        }
+
+        //receiver had dup fds
+        closePendingFds(pending);
+        pending->sentLen += sentLen;
+        if (pending->sentLen < pending->len) {
+            return NO_ERROR;
+        }
+
+        if (pending->isFrame) {
+            mPendingFrameCnt--;
+        }
+        mPendingMsgs.pop_front();
+    }
+    return NO_ERROR;
+}
+
+void WstClientSocket::sendKeepLastFrameVideoClientConnection(bool keep)
+{
+    unsigned char mbody[7];
+    int len;
+    int ret;
 
     len= 0;
     mbody[len++] = 'V';
@@ -678,16 +707,9 @@ void WstClientSocket::sendKeepLastFrameVideoClientConnection(bool keep)
     mbody[len++] = 'K';
     mbody[len++] = (keep ? 1 : 0);
 
-    iov[0].iov_base = (char*)mbody;
-    iov[0].iov_len = len;
+    ret = queueOrderedMessage(mbody, len);
 
-    do
-    {
-        sentLen = sendmsg( mSocketFd, &msg, MSG_NOSIGNAL );
-    }
-    while ( (sentLen < 0) && (errno == EINTR));
-
-    if ( sentLen == len )
+    if ( ret == NO_ERROR )
     {
         INFO(mLogCategory,"sent keep last frame %d to video server", keep);
     }
@@ -764,13 +786,16 @@ void WstClientSocket::processMessagesVideoClientConnection()
                         /* set position from frame currently presented by the video server */
                         uint64_t frameTime = getS64( &m[4] );
                         uint32_t numDropped = getU32( &m[12] );
-                        DEBUG(mLogCategory,"out: status received: frameTime %lld numDropped %d", frameTime, numDropped);
+                        //render server appends systemtime us it presented frame at
+                        int64_t presentTime = (mlen >= 25)? getS64( &m[20] ) : -1;
+                        DEBUG(mLogCategory,"out: status received: frameTime %lld numDropped %d presentTime %lld", frameTime, numDropped, presentTime);
                         if ( mPlugin )
                         {
                             WstEvent wstEvent;
                             wstEvent.event = WST_STATUS;
                             wstEvent.param = numDropped;
                             wstEvent.lparam = frameTime;
+                            wstEvent.lparam1 = presentTime;
                             mPlugin->onWstSocketEvent(&wstEvent);
                         }
                     }
@@ -853,13 +878,31 @@ void WstClientSocket::readyToRun()
 bool WstClientSocket::threadLoop()
 {
     int ret;
-    ret = mPoll->wait(-1); //wait for ever
+    int64_t timeoutNs = -1; //wait for ever
+
+    //no frame carried the control changes in time,send them alone
+    flushControlMessages(false);
+    mControlMutex.lock();
+    if (mDirtyControls) {
+        int64_t remainUs = mDirtySinceUs + WST_CONTROL_FLUSH_TIME_US - Tls::Times::getSystemTimeUs();
+        timeoutNs = remainUs > 0? remainUs*1000 : 1000;
+    }
+    mControlMutex.unlock();
+
+    ret = mPoll->wait(timeoutNs);
     if (ret < 0) { //poll error
         WARNING(mLogCategory,"poll error");
         return false;
-    } else if (ret == 0) { //poll time out
+    } else if (ret == 0) { //poll time out or wakeup
         return true; //run loop
     }
+    if (mPoll->isWritable(mSocketFd)) {
+        Tls::Mutex::Autolock _l(mSendMutex);
+        drainPendingMessages(NULL);
+        if (mPendingMsgs.empty()) {
+            mPoll->setFdWritable(mSocketFd, false);
+        }
+    }
     processMessagesVideoClientConnection();
     return true;
 }
\ No newline at end of file
@@ -12,14 +12,25 @@
 #include <stdint.h>
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <deque>
 #include "Thread.h"
 #include "Poll.h"
+#include "Mutex.h"
 
 #ifdef  __cplusplus
 extern "C" {
 #endif
 
 #define WST_MAX_PLANES (3)
+/*max messages queued when westeros server is slow to drain socket,
+frames are refused above it,control messages grow the queue*/
+#define WST_MAX_PENDING_MSGS (16)
+/*max frames queued,more frames are refused with ERROR_WOULD_BLOCK*/
+#define WST_MAX_PENDING_FRAMES (1)
+/*max length of a queued message,frame message with all control messages*/
+#define WST_MAX_MSG_LEN (128)
+/*max time control changes wait for a frame to carry them*/
+#define WST_CONTROL_FLUSH_TIME_US (16000)
 #define AV_SYNC_SESSION_V_MONO 64 //when set it, AV_SYNC_MODE_VIDEO_MONO of sync mode must be selected
 
 enum av_sync_mode {
@@ -78,6 +89,7 @@ typedef struct _WstEvent
     int param1;
     int param2;
     int64_t lparam;
+    int64_t lparam1;
 } WstEvent;
 
 #ifdef  __cplusplus
@@ -101,19 +113,84 @@ class WstClientSocket : public Tls::Thread{
     void sendLayerVideoClientConnection(bool pip);
     void sendResourceVideoClientConnection(bool pip);
     void sendFlushVideoClientConnection();
+    /*
+     * pause,hide,rect and rate changes are accumulated and sent
+     * with next frame,or alone if no frame comes in
+     * WST_CONTROL_FLUSH_TIME_US,only the last value of each is sent
+     */
     void sendPauseVideoClientConnection(bool pause);
     void sendHideVideoClientConnection(bool hide);
     void sendSessionInfoVideoClientConnection(int sessionId, int syncType );
     void sendFrameAdvanceVideoClientConnection();
     void sendRectVideoClientConnection(int videoX, int videoY, int videoWidth, int videoHeight );
     void sendRateVideoClientConnection(int fpsNum, int fpsDenom );
-    bool sendFrameVideoClientConnection(WstBufferInfo *wstBufferInfo, WstRect *wstRect);
+    /**
+     * @brief send video frame to westeros server,it never blocks
+     *
+     * @param wstBufferInfo frame buffer info
+     * @param wstRect video rect
+     * @return int NO_ERROR if sent or queued, ERROR_WOULD_BLOCK if
+     *      socket is busy and frame is not taken, other fail
+     */
+    int sendFrameVideoClientConnection(WstBufferInfo *wstBufferInfo, WstRect *wstRect);
     void processMessagesVideoClientConnection();
     void sendKeepLastFrameVideoClientConnection(bool keep);
         //thread func
     void readyToRun();
     virtual bool threadLoop();
   private:
+    enum {
+        WST_CONTROL_RECT = 1 << 0,
+        WST_CONTROL_RATE = 1 << 1,
+        WST_CONTROL_PAUSE = 1 << 2,
+        WST_CONTROL_HIDE = 1 << 3,
+    };
+    typedef struct {
+        unsigned char body[WST_MAX_MSG_LEN];
+        int len;
+        int sentLen;
+        int fds[WST_MAX_PLANES];
+        int numFds;
+        bool isFrame;
+    } PendingMsg;
+    /**
+     * @brief queue a message to outbound queue and try to send
+     * queued messages without blocking,the fds are owned by queue
+     * and closed after sent or refused,only frames are refused
+     * when queue is full,control messages are kept in order
+     *
+     * @return int NO_ERROR if sent or queued, ERROR_WOULD_BLOCK if
+     *      too many frames pending, other fail
+     */
+    int queueMessage(unsigned char *body, int len, int *fds, int numFds, bool isFrame);
+    /**
+     * @brief queue a message not batched with frames,dirty control
+     * changes are sent before it in the same message
+     *
+     * @return int NO_ERROR if sent or queued, other fail
+     */
+    int queueOrderedMessage(unsigned char *body, int len);
+    /**
+     * @brief send queued messages until socket would block,
+     * must hold mSendMutex,a message failed to send is dropped
+     *
+     * @param own message of caller,NULL if none
+     * @return int NO_ERROR if own message is sent or still queued,
+     *      other if own message failed
+     */
+    int drainPendingMessages(PendingMsg *own);
+    void closePendingFds(PendingMsg *pending);
+    /*control changes helpers,must hold mControlMutex*/
+    void markControlDirty(int control);
+    int buildControlMessages(unsigned char *mbody);
+    void onControlMessagesSent();
+    /**
+     * @brief send dirty control changes alone
+     *
+     * @param force if false,send only when they had waited
+     *      WST_CONTROL_FLUSH_TIME_US for a frame
+     */
+    void flushControlMessages(bool force);
     int mLogCategory;
     const char *mName;
     struct sockaddr_un mAddr;
@@ -123,6 +200,21 @@ class WstClientSocket : public Tls::Thread{
     int mZoomMode;
     WstClientPlugin *mPlugin;
     Tls::Poll *mPoll;
+
+    //outbound queue,drained by socket thread when writable
+    mutable Tls::Mutex mSendMutex;
+    std::deque<PendingMsg> mPendingMsgs;
+    int mPendingFrameCnt;
+
+    //control changes not sent yet
+    mutable Tls::Mutex mControlMutex;
+    int mDirtyControls;
+    int64_t mDirtySinceUs;
+    WstRect mControlRect;
+    int mControlFpsNum;
+    int mControlFpsDenom;
+    bool mControlPause;
+    bool mControlHide;
 };
 
 #endif /*_WST_SOCKET_CLIENT_H_*/
@@ -10,6 +10,7 @@
 #include "wayland_display.h"
 #include "ErrorCode.h"
 #include "Logger.h"
+#include "Times.h"
 #include "wayland_plugin.h"
 #include "wayland_videoformat.h"
 
@@ -205,6 +206,7 @@ WaylandDisplay::WaylandDisplay(WaylandPlugin *plugin, int logCategory)
     mViewporter = NULL;
     mDmabuf = NULL;
     mShm = NULL;
+    mTimerDeadlineUs = 0;
     mPoll = new Tls::Poll(true);
 }
 
@@ -411,9 +413,28 @@ void WaylandDisplay::readyToRun()
     }
 }
 
+void WaylandDisplay::armTimer(int64_t deadlineUs)
+{
+    mTimerDeadlineUs = deadlineUs;
+    //event thread must recompute its wait
+    mPoll->wakeup();
+}
+
+void WaylandDisplay::checkTimer()
+{
+    int64_t deadlineUs = mTimerDeadlineUs;
+
+    if (deadlineUs > 0 && Tls::Times::getSystemTimeUs() >= deadlineUs &&
+        mTimerDeadlineUs.compare_exchange_strong(deadlineUs, 0)) {
+        mWaylandPlugin->handleTimer();
+    }
+}
+
 bool WaylandDisplay::threadLoop()
 {
     int ret;
+    int64_t timeoutNs = -1;
+    int64_t deadlineUs = mTimerDeadlineUs;
 
     while (wl_display_prepare_read_queue (mWlDisplay, mWlQueue) != 0) {
       wl_display_dispatch_queue_pending (mWlDisplay, mWlQueue);
@@ -422,13 +443,19 @@ bool WaylandDisplay::threadLoop()
     wl_display_flush (mWlDisplay);
 
     /*poll timeout value must > 300 ms,otherwise zwp_linux_dmabuf will create failed,
-     so do use -1 to wait for ever*/
-    ret = mPoll->wait(-1); //wait for ever
+     so do use -1 to wait for ever,unless a timer is armed*/
+    if (deadlineUs > 0) {
+        int64_t remainUs = deadlineUs - Tls::Times::getSystemTimeUs();
+        timeoutNs = remainUs > 0? remainUs*1000 : 1000;
+    }
+    ret = mPoll->wait(timeoutNs);
     if (ret < 0) { //poll error
         WARNING(mLogCategory,"poll error");
         wl_display_cancel_read(mWlDisplay);
         return false;
-    } else if (ret == 0) { //poll time out
+    } else if (ret == 0) { //poll time out or wakeup
+        wl_display_cancel_read(mWlDisplay);
+        checkTimer();
         return true; //run loop
     }
 
@@ -437,6 +464,7 @@ bool WaylandDisplay::threadLoop()
     }
 
     wl_display_dispatch_queue_pending (mWlDisplay, mWlQueue);
+    checkTimer();
     return true;
 tag_error:
     ERROR(mLogCategory,"Error communicating with the wayland server");
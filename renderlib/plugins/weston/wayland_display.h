@@ -13,6 +13,7 @@
 #include <pthread.h>
 #include <poll.h>
 #include <list>
+#include <atomic>
 #include <unordered_map>
 #include <wayland-client.h>
 #include "xdg-shell-client-protocol.h"
@@ -70,6 +71,14 @@ class WaylandDisplay : public Tls::Thread{
     //thread func
     void readyToRun();
     virtual bool threadLoop();
+    /**
+     * @brief wake event thread at deadline to call
+     * WaylandPlugin::handleTimer,a later call replaces
+     * the deadline set before
+     *
+     * @param deadlineUs system time us
+     */
+    void armTimer(int64_t deadlineUs);
 
     struct wl_display *getWlDisplay() {
         return mWlDisplay;
@@ -160,6 +169,8 @@ class WaylandDisplay : public Tls::Thread{
     mutable Tls::Mutex mMutex;
     int mFd;
     Tls::Poll *mPoll;
+    std::atomic<int64_t> mTimerDeadlineUs; /*0 if timer not armed*/
+    void checkTimer();
 };
 
 #endif /*__WAYLAND_DISPLAY_H__*/
\ No newline at end of file
@@ -76,7 +76,6 @@ struct wl_buffer *WaylandDmaBuffer::constructWlBuffer(RenderDmaBuffer *dmabuf, R
 {
     struct zwp_linux_buffer_params_v1 *params = NULL;
     int ret;
-    int64_t timeout;
     uint64_t formatModifier = 0;
     uint32_t flags = 0;
     uint32_t dmabufferFormat;
@@ -117,14 +116,26 @@ struct wl_buffer *WaylandDmaBuffer::constructWlBuffer(RenderDmaBuffer *dmabuf, R
                    formatModifier & 0xffffffff);
     }
 
-    /* Request buffer creation */
+    /* Request buffer creation,create_immed needs no round trip to wait
+       compositor answer,so first frame is not delayed by buffer import */
+    if (zwp_linux_dmabuf_v1_get_version (mDisplay->getDmaBuf()) >= ZWP_LINUX_BUFFER_PARAMS_V1_CREATE_IMMED_SINCE_VERSION) {
+        TRACE1(mLogCategory,"zwp_linux_buffer_params_v1_create_immed,dma width:%d,height:%d,dmabufferformat:%d",dmabuf->width,dmabuf->height,dmabufferFormat);
+        mWlBuffer = zwp_linux_buffer_params_v1_create_immed (params, dmabuf->width, dmabuf->height, dmabufferFormat, flags);
+        if (!mWlBuffer) {
+            ERROR(mLogCategory,"zwp_linux_buffer_params_v1_create_immed fail");
+        }
+        //destroy zwp linux buffer params
+        zwp_linux_buffer_params_v1_destroy (params);
+        return mWlBuffer;
+    }
+
     zwp_linux_buffer_params_v1_add_listener (params, &dmabuf_params_listener, (void *)this);
     TRACE1(mLogCategory,"zwp_linux_buffer_params_v1_create,dma width:%d,height:%d,dmabufferformat:%d",dmabuf->width,dmabuf->height,dmabufferFormat);
     zwp_linux_buffer_params_v1_create (params, dmabuf->width, dmabuf->height, dmabufferFormat, flags);
 
     /* Wait for the request answer */
     wl_display_flush (mDisplay->getWlDisplay());
-    Tls::Mutex::Autolock _l(mMutex);
+    mMutex.lock();
     if (!mWlBuffer) { //if this wlbuffer had created,don't wait zwp linux buffer callback
         mWlBuffer =(struct wl_buffer *)0xffffffff;
         while (mWlBuffer == (struct wl_buffer *)0xffffffff) { //try wait for 1000 ms
@@ -134,6 +145,7 @@ struct wl_buffer *WaylandDmaBuffer::constructWlBuffer(RenderDmaBuffer *dmabuf, R
             }
         }
     }
+    mMutex.unlock();
     //destroy zwp linux buffer params
     zwp_linux_buffer_params_v1_destroy (params);
 
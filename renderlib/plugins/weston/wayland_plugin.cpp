@@ -180,6 +180,12 @@ int WaylandPlugin::set(int key, void *value)
             DEBUG(mLogCategory,"Set video format :%d",videoFormat);
             mDisplay->setVideoBufferFormat((RenderVideoFormat)videoFormat);
         } break;
+        case PLUGIN_KEY_COMMIT_BATCH: {
+            int batch = *(int *)(value);
+            if (mWindow) {
+                mWindow->setCommitBatch(batch != 0);
+            }
+        } break;
     }
     return NO_ERROR;
 }
@@ -210,10 +216,24 @@ void WaylandPlugin::handleFrameDropped(RenderBuffer *buffer)
     }
 }
 
+void WaylandPlugin::handleTimer()
+{
+    if (mWindow) {
+        mWindow->publishStagedGeometry();
+    }
+}
+
 void WaylandPlugin::handDisplayOutputModeChanged(int width, int height, int refreshRate)
 {
     INFO(mLogCategory, "current display mode, width:%d, height:%d,refreshRate:%d",width, height, refreshRate);
     if (mWindow) {
         mWindow->setRenderRectangle(0, 0, width, height);
     }
+    if (mCallback) {
+        PluginDisplayMode mode;
+        mode.width = width;
+        mode.height = height;
+        mode.refreshRate = refreshRate;
+        mCallback->doSendMsgCallback(mUserData, PLUGIN_MSG_DISPLAY_MODE_CHANGED, &mode);
+    }
 }
\ No newline at end of file
@@ -41,6 +41,8 @@ class WaylandPlugin : public RenderPlugin
     //buffer droped callback
     virtual void handleFrameDropped(RenderBuffer *buffer);
     void handDisplayOutputModeChanged(int width, int height, int refreshRate);
+    /*called by display event thread when armed timer expires*/
+    void handleTimer();
   private:
     PluginCallback *mCallback;
     WaylandDisplay *mDisplay;
@@ -13,6 +13,7 @@
 #include "wayland_plugin.h"
 #include "ErrorCode.h"
 #include "Logger.h"
+#include "Times.h"
 #include "wayland_shm.h"
 #include "wayland_dma.h"
 
@@ -91,6 +92,11 @@ WaylandWindow::WaylandWindow(WaylandDisplay *wlDisplay, int logCatgory)
     mNoBorderUpdate = false;
     mAreaShmBuffer = NULL;
     mCommitCnt = 0;
+    mGeometryPending = false;
+    mBordersPending = false;
+    mLastCommitTimeUs = 0;
+    mCommitBatch = false;
+    mBatchStaged = false;
     mIsSendPtsToWeston = true;
     mReCommitAreaSurface = false;
     mAreaSurface = NULL;
@@ -306,48 +312,127 @@ void WaylandWindow::setRenderRectangle(int x, int y, int w, int h)
         return;
     }
 
-    if (mAreaViewport) {
-        wp_viewport_set_destination (mAreaViewport, w, h);
-    }
-
-    updateBorders();
-
-    if (mVideoWidth != 0 && mVideoSurface) {
-        wl_subsurface_set_sync (mVideoSubSurface);
-        resizeVideoSurface(true);
-    }
-
-    wl_surface_damage (mAreaSurfaceWrapper, 0, 0, w, h);
-    wl_surface_commit (mAreaSurfaceWrapper);
-
-    if (mVideoWidth != 0) {
-        wl_subsurface_set_desync (mVideoSubSurface);
-    }
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    stageGeometry(true);
 }
 
 void WaylandWindow::setFrameSize(int w, int h)
 {
+    Tls::Mutex::Autolock _l(mRenderMutex);
     mVideoWidth = w;
     mVideoHeight = h;
     TRACE1(mLogCategory,"frame w:%d,h:%d",mVideoWidth,mVideoHeight);
     if (mRenderRect.w > 0 && mVideoSurface) {
-        resizeVideoSurface(true);
+        stageGeometry(false);
     }
 }
 
 void WaylandWindow::setWindowSize(int x, int y, int w, int h)
 {
+    Tls::Mutex::Autolock _l(mRenderMutex);
     mWindowRect.x = x;
     mWindowRect.y = y;
     mWindowRect.w = w;
     mWindowRect.h = h;
     TRACE1(mLogCategory,"window size:x:%d,y:%d,w:%d,h:%d",mWindowRect.x,mWindowRect.y,mWindowRect.w,mWindowRect.h);
     if (mWindowRect.w > 0 && mVideoWidth > 0 && mVideoSurface) {
-        resizeVideoSurface(true);
+        stageGeometry(false);
+    }
+}
+
+/*must hold mRenderMutex,geometry is published together with
+the next video buffer so border,position and scaling never
+show a frame of the old layout,if frames are not flowing
+e.g. paused,it is published at once*/
+void WaylandWindow::stageGeometry(bool borders)
+{
+    mGeometryPending = true;
+    if (borders) {
+        mBordersPending = true;
+    }
+    if (Tls::Times::getSystemTimeUs() - mLastCommitTimeUs >= GEOMETRY_STAGE_TIMEOUT_US) {
+        TRACE1(mLogCategory,"no frame committing,publish geometry now");
+        commitSurfaces(false);
+        wl_display_flush (mDisplay->getWlDisplay());
+    } else {
+        //frames may stop before next one,e.g. pause or end of stream
+        mDisplay->armTimer(mLastCommitTimeUs + GEOMETRY_STAGE_TIMEOUT_US);
+    }
+}
+
+void WaylandWindow::publishStagedGeometry()
+{
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    if (!mGeometryPending) {
+        return;
+    }
+    if (Tls::Times::getSystemTimeUs() - mLastCommitTimeUs >= GEOMETRY_STAGE_TIMEOUT_US) {
+        TRACE1(mLogCategory,"frames stopped,publish staged geometry");
+        commitSurfaces(false);
+        wl_display_flush (mDisplay->getWlDisplay());
+    } else {
+        mDisplay->armTimer(mLastCommitTimeUs + GEOMETRY_STAGE_TIMEOUT_US);
     }
 }
 
-void WaylandWindow::resizeVideoSurface(bool commit)
+void WaylandWindow::setCommitBatch(bool batch)
+{
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    mCommitBatch = batch;
+    if (batch || !mBatchStaged) {
+        return;
+    }
+    mBatchStaged = false;
+    commitSurfaces(true);
+    mLastCommitTimeUs = Tls::Times::getSystemTimeUs();
+    wl_display_flush (mDisplay->getWlDisplay());
+}
+
+/*must hold mRenderMutex,commit video surface,if geometry is
+pending or parent commit is asked,video subsurface is set sync
+so its state is cached and applied with parent surface state
+in one parent commit*/
+void WaylandWindow::commitSurfaces(bool parentCommit)
+{
+    bool geometry = mGeometryPending && mVideoSubSurface && mRenderRect.w > 0;
+    bool parent = (geometry || parentCommit) && mVideoSubSurface;
+
+    if (parent) {
+        wl_subsurface_set_sync (mVideoSubSurface);
+    }
+    if (geometry) {
+        if (mBordersPending) {
+            if (mAreaViewport) {
+                wp_viewport_set_destination (mAreaViewport, mRenderRect.w, mRenderRect.h);
+            }
+            updateBorders();
+        }
+        if (mVideoWidth > 0) {
+            resizeVideoSurface();
+        }
+    }
+
+    wl_surface_damage (mVideoSurfaceWrapper, 0, 0, mVideoRect.w, mVideoRect.h);
+    wl_surface_commit (mVideoSurfaceWrapper);
+
+    if (parent) {
+        if (geometry) {
+            wl_surface_damage (mAreaSurfaceWrapper, 0, 0, mRenderRect.w, mRenderRect.h);
+        }
+        wl_surface_commit (mAreaSurfaceWrapper);
+        wl_subsurface_set_desync (mVideoSubSurface);
+    }
+    if (geometry) {
+        mGeometryPending = false;
+        mBordersPending = false;
+        TRACE1(mLogCategory,"geometry published,video rectangle,x:%d,y:%d,w:%d,h:%d",
+            mVideoRect.x, mVideoRect.y, mVideoRect.w, mVideoRect.h);
+    }
+}
+
+/*only stages video surface position and scaling,they
+take effect on commitSurfaces*/
+void WaylandWindow::resizeVideoSurface()
 {
     Rectangle src = {0,};
     Rectangle dst = {0,};
@@ -388,11 +473,6 @@ void WaylandWindow::resizeVideoSurface(bool commit)
 
     wl_subsurface_set_position (mVideoSubSurface, res.x, res.y);
 
-    if (commit) {
-        wl_surface_damage (mVideoSurfaceWrapper, 0, 0, res.w, res.h);
-        wl_surface_commit (mVideoSurfaceWrapper);
-    }
-
     //top level setting
     if (mXdgToplevel) {
         struct wl_region *region;
@@ -429,6 +509,7 @@ void WaylandWindow::displayFrameBuffer(RenderBuffer * buf, int64_t realDisplayTi
 {
     WaylandBuffer *waylandBuf = NULL;
     struct wl_buffer * wlbuffer = NULL;
+    bool staged = false;
     int ret;
 
     if (!buf) {
@@ -504,15 +585,23 @@ void WaylandWindow::displayFrameBuffer(RenderBuffer * buf, int64_t realDisplayTi
             wl_surface_attach (mVideoSurfaceWrapper, wlbuffer, 0, 0);
         }
 
-        wl_surface_damage (mVideoSurfaceWrapper, 0, 0, mVideoRect.w, mVideoRect.h);
-        wl_surface_commit (mVideoSurfaceWrapper);
+        if (mCommitBatch) {
+            //shown by parent commit when batch ends
+            mBatchStaged = true;
+            staged = true;
+        } else {
+            commitSurfaces(false);
+            mLastCommitTimeUs = Tls::Times::getSystemTimeUs();
+        }
     } else {
         WARNING(mLogCategory,"wlbuffer is NULL");
         /* clear both video and parent surfaces */
         cleanSurface();
     }
 
-    wl_display_flush (mDisplay->getWlDisplay());
+    if (!staged) {
+        wl_display_flush (mDisplay->getWlDisplay());
+    }
 
     /*after commiting wl_buffer to weston,
     notify this buffer had displayed,this is used to count
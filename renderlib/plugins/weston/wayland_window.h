@@ -32,7 +32,20 @@ class WaylandWindow
     void setFrameSize(int w, int h);
     void setWindowSize(int x, int y, int w, int h);
     void displayFrameBuffer(RenderBuffer * buf, int64_t realDisplayTime);
-    void resizeVideoSurface(bool commit);
+    void resizeVideoSurface();
+    /**
+     * @brief publish staged geometry if no frame was committed
+     * in GEOMETRY_STAGE_TIMEOUT_US,called on display timer
+     */
+    void publishStagedGeometry();
+    /**
+     * @brief begin or end a commit batch of shared display
+     * scheduler,frames in batch are staged on synchronized video
+     * subsurface and shown by one parent commit when batch ends
+     *
+     * @param batch true to begin,false to end and publish
+     */
+    void setCommitBatch(bool batch);
     void setOpaque();
     void handleBufferReleaseCallback(WaylandBuffer *buf);
     void handleFrameDisplayedCallback(WaylandBuffer *buf);
@@ -67,6 +80,8 @@ class WaylandWindow
     void updateBorders();
     std::size_t calculateDmaBufferHash(RenderDmaBuffer &dmabuf);
     void cleanSurface();
+    void stageGeometry(bool borders);
+    void commitSurfaces(bool parentCommit);
     mutable Tls::Mutex mRenderMutex;
     WaylandDisplay *mDisplay;
     struct wl_surface *mAreaSurface;
@@ -105,6 +120,17 @@ class WaylandWindow
     //the count display buffer of committed to weston
     int mCommitCnt;
 
+    /*geometry changed,published with next video commit*/
+    bool mGeometryPending;
+    /*area viewport and borders need update*/
+    bool mBordersPending;
+    //system time of last video buffer commit,us
+    int64_t mLastCommitTimeUs;
+    /*frames are staged until commit batch ends*/
+    bool mCommitBatch;
+    /*a frame is attached and not committed in batch*/
+    bool mBatchStaged;
+
     std::unordered_map<std::size_t, WaylandBuffer *> mWaylandBuffersMap;
     bool mNoBorderUpdate;
 
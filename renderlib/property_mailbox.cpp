@@ -0,0 +1,96 @@
+#include <string.h>
+#include "property_mailbox.h"
+
+PropertyMailbox::PropertyMailbox()
+{
+    memset(&mUntargeted, 0, sizeof(PropertySnapshot));
+    mUntargeted.pts = -1;
+}
+
+PropertyMailbox::~PropertyMailbox()
+{
+}
+
+void PropertyMailbox::merge(PropertySnapshot *dst, const PropertySnapshot *src)
+{
+    //src is posted later,its fields win
+    if (src->changed & PROPERTY_CHANGED_WINDOW_SIZE) {
+        dst->winSize = src->winSize;
+    }
+    if (src->changed & PROPERTY_CHANGED_FRAME_SIZE) {
+        dst->frameWidth = src->frameWidth;
+        dst->frameHeight = src->frameHeight;
+    }
+    dst->changed |= src->changed;
+    dst->version = src->version;
+}
+
+void PropertyMailbox::post(const PropertySnapshot *snapshot)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (snapshot->pts < 0) {
+        merge(&mUntargeted, snapshot);
+        return;
+    }
+    auto item = mTargeted.begin();
+    while (item != mTargeted.end() && item->pts <= snapshot->pts) {
+        item++;
+    }
+    //same target pts,later post wins
+    if (item != mTargeted.begin()) {
+        auto prev = std::prev(item);
+        if (prev->pts == snapshot->pts) {
+            merge(&(*prev), snapshot);
+            return;
+        }
+    }
+    mTargeted.insert(item, *snapshot);
+    if (mTargeted.size() > PROPERTY_MAILBOX_MAX_TARGETED) {
+        //changes of oldest are applied with the next target
+        PropertySnapshot merged = mTargeted.front();
+        mTargeted.pop_front();
+        merge(&merged, &mTargeted.front());
+        merged.pts = mTargeted.front().pts;
+        mTargeted.front() = merged;
+    }
+}
+
+bool PropertyMailbox::fetch(int64_t pts, bool all, PropertySnapshot *snapshot)
+{
+    PropertySnapshot due[PROPERTY_MAILBOX_MAX_TARGETED + 1];
+    int cnt = 0;
+
+    mMutex.lock();
+    if (mUntargeted.changed) {
+        due[cnt++] = mUntargeted;
+        mUntargeted.changed = 0;
+    }
+    while (!mTargeted.empty() && (all || (pts >= 0 && mTargeted.front().pts <= pts))) {
+        due[cnt++] = mTargeted.front();
+        mTargeted.pop_front();
+    }
+    mMutex.unlock();
+
+    if (cnt == 0) {
+        return false;
+    }
+    //merge in post order
+    memset(snapshot, 0, sizeof(PropertySnapshot));
+    snapshot->pts = pts;
+    for (int i = 0; i < cnt; i++) {
+        int oldest = i;
+        for (int j = i + 1; j < cnt; j++) {
+            if (due[j].version < due[oldest].version) {
+                oldest = j;
+            }
+        }
+        if (oldest != i) {
+            PropertySnapshot tmp = due[i];
+            due[i] = due[oldest];
+            due[oldest] = tmp;
+        }
+        merge(snapshot, &due[i]);
+    }
+    return true;
+}
@@ -0,0 +1,63 @@
+#ifndef __PROPERTY_MAILBOX_H__
+#define __PROPERTY_MAILBOX_H__
+#include <stdint.h>
+#include <mutex>
+#include <list>
+#include "render_lib.h"
+
+/*max targeted snapshots waiting their frames*/
+#define PROPERTY_MAILBOX_MAX_TARGETED 8
+
+/*properties changed by a snapshot*/
+enum _PropertyChanged {
+    PROPERTY_CHANGED_WINDOW_SIZE = 1 << 0,
+    PROPERTY_CHANGED_FRAME_SIZE = 1 << 1,
+};
+
+/*properties applied on display thread,only changed ones are valid*/
+typedef struct _PropertySnapshot {
+    uint32_t version; /*increased on every post*/
+    int64_t pts; /*ns unit,frame the snapshot is applied with,-1 at once*/
+    uint32_t changed; /*see _PropertyChanged*/
+    RenderWindowSize winSize;
+    int frameWidth;
+    int frameHeight;
+} PropertySnapshot;
+
+/**
+ * @brief single producer,single consumer mailbox of property
+ * snapshots.untargeted snapshots are merged into one,targeted
+ * ones are kept in pts order until their frame is displayed,so
+ * a later post never cancels a pending targeted change.both
+ * sides hold the lock only to copy a few snapshots
+ */
+class PropertyMailbox {
+  public:
+    PropertyMailbox();
+    virtual ~PropertyMailbox();
+    /**
+     * @brief post a snapshot,producer side.if targeted ones are
+     * full,the oldest is merged into the next one
+     *
+     * @param snapshot snapshot to post
+     */
+    void post(const PropertySnapshot *snapshot);
+    /**
+     * @brief fetch changes due,consumer side,due changes are
+     * merged in post order
+     *
+     * @param pts ns unit,pts of frame to be displayed,-1 if no
+     * frame,targeted changes up to it are due
+     * @param all all targeted changes are due
+     * @param snapshot the merged changes
+     * @return true if any change is due
+     */
+    bool fetch(int64_t pts, bool all, PropertySnapshot *snapshot);
+  private:
+    static void merge(PropertySnapshot *dst, const PropertySnapshot *src);
+    std::mutex mMutex;
+    PropertySnapshot mUntargeted; /*merged untargeted changes,changed 0 if none*/
+    std::list<PropertySnapshot> mTargeted; /*pts order*/
+};
+
+#endif /*__PROPERTY_MAILBOX_H__*/
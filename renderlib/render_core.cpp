@@ -1,4 +1,5 @@
 #include <string.h>
+#include <algorithm>
 #include "render_core.h"
 #include "Logger.h"
 #include "wayland_plugin.h"
@@ -8,6 +9,7 @@
 #include "drm_plugin.h"
 #include "Times.h"
 #include "config.h"
+#include "display_scheduler.h"
 
 #define TAG "rlib:render_core"
 
@@ -17,21 +19,22 @@
 RenderCore::RenderCore(int renderlibId, int logCategory)
     : mRenderlibId(renderlibId),
     mLogCategory(logCategory),
-    mPaused(false),
-    mFlushing(false),
     mMediaSynInstID(-1),
     mVideoFormat(VIDEO_FORMAT_UNKNOWN),
     mRenderMutex("renderMutex"),
+    mInputMutex("inputMutex"),
+    mConfigMutex("configMutex"),
     mLimitMutex("limitSendMutex"),
-    mBufferMgrMutex("bufferMutex")
+    mBufferMgrMutex("bufferMutex"),
+    mReleaseMutex("releaseMutex")
 {
     mCallback = NULL;
     mMediaSync= NULL;
     mPlugin = NULL;
-    mWinSizeChanged = false;
     mFrameWidth = 0;
     mFrameHeight = 0;
-    mFrameChanged = false;
+    mPropertyVersion = 0;
+    memset(&mAppliedProps, 0, sizeof(PropertySnapshot));
     mDemuxId = 0;
     mPcrId = 0x1fff;
     mSyncmode = MEDIA_SYNC_MODE_MAX;
@@ -42,12 +45,11 @@ RenderCore::RenderCore(int renderlibId, int logCategory)
     mVideoFPS = 0;
     mVideoFPS_N = 0;
     mVideoFPS_D = 0;
-    mFPSIntervalMs = 0;
-    mFPSDetectCnt = 0;
-    mFPSDetectAcc = 0;
+    mFrameIntervalNs = 0;
     mDropFrameCnt = 0;
     mBufferId = 1;
     mLastDisplaySystemtime = 0;
+    mDisplayLatencyUs = LATENCY_TO_HDMI_TIME_US;
     mWaitAnchorTimeUs = 0;
     mReleaseFrameCnt = 0;
     mDisplayedFrameCnt = 0;
@@ -69,6 +71,49 @@ RenderCore::RenderCore(int renderlibId, int logCategory)
     mIsLimitDisplayFrame = true;
     mMediaSyncInstanceIDSet = false;
     mMediaSyncAnchor = false;
+    mDisplayBusy = false;
+    mFreeRunAnchorPts = -1;
+    mFreeRunAnchorTimeUs = 0;
+    mPlaybackRate = 1.0f;
+    mFreeRunCurRate = 1.0f;
+    mFreeRunReanchor = false;
+    mFreeRunRefreshRate = 0;
+    mFreeRunSlew = 0.0f;
+    mFreeRunAnchorRate = 1.0f;
+    mJitterBufferEnable = false;
+    mJitterTargetDepth = 1;
+    mJitterShrinkTimeUs = 0;
+    mJitterPrebufferStartUs = 0;
+    mQosIntervalMs = QOS_DEFAULT_INTERVAL_MS;
+    memset(&mQos, 0, sizeof(RenderQos));
+    mQosLastSendUs = 0;
+    mQosBehind = false;
+    memset(&mCadence, 0, sizeof(RenderDisplayCadence));
+    mRequestedRefreshRate = 0;
+    mDecimateIntervalNs = 0;
+    mDecimationChanged = false;
+    mLastKeptPts = -1;
+    mLowLatencyMode = false;
+    mLatestFrame = NULL;
+    mReorderDepth = 0;
+    mLastEmittedPts = -1;
+    mGeneration = 0;
+    mStaleFrameCnt = 0;
+    mPluginFlushPending = false;
+    mLastReorderInputUs = 0;
+    mFastFirstFrame = false;
+    mQueueMaxDepth = 0;
+    mQueueFullPolicy = QUEUE_FULL_POLICY_BLOCK;
+    mStandby = false;
+    mSharedScheduler = false;
+    mScheduled = false;
+    mNextWakeUs = 0;
+    mPacingKick = 0;
+    mSessionCache = false;
+    mPluginAdopted = false;
+    mAdoptedPip = 0;
+    mSparePlugin = NULL;
+    mVideoPip = 0;
     mQueue = new Tls::Queue();
     //limit display frame,invalid when value is 0,other > 0 is enable
     char *env = getenv("VIDEO_RENDER_LIMIT_SEND_FRAME");
@@ -79,6 +124,12 @@ RenderCore::RenderCore(int renderlibId, int logCategory)
             INFO(mLogCategory,"No limit send frame");
         }
     }
+    //keep plugin connected after close for next session,value is not 0 is enable
+    env = getenv("VIDEO_RENDER_SESSION_CACHE");
+    if (env && atoi(env) != 0) {
+        mSessionCache = true;
+        INFO(mLogCategory,"Session cache enabled");
+    }
 
     mAllRenderBufferMap.clear();
 }
@@ -94,6 +145,23 @@ static PluginCallback plugincallback = {
     RenderCore::pluginBufferDropedCallback
 };
 
+//parked plugin has no render core,it is parked only after all
+//buffers of closed session were returned
+static void parkedMsgCallback(void *handle, int msg, void *detail)
+{
+}
+
+static void parkedBufferCallback(void *handle, void *data)
+{
+}
+
+static PluginCallback parkedcallback = {
+    parkedMsgCallback,
+    parkedBufferCallback,
+    parkedBufferCallback,
+    parkedBufferCallback
+};
+
 int RenderCore::init(char *name)
 {
     DEBUG(mLogCategory,"name:%s",name);
@@ -139,19 +207,105 @@ int RenderCore::init(char *name)
     return NO_ERROR;
 }
 
+RenderPlugin *RenderCore::detachPlugin()
+{
+    RenderPlugin *plugin;
+    int hide = 1;
+
+    if (!mSessionCache || !mPlugin) {
+        return NULL;
+    }
+    int pluginState = mPlugin->getState();
+    if (!(pluginState & PLUGIN_STATE_DISPLAY_OPENED) || !(pluginState & PLUGIN_STATE_WINDOW_OPENED)) {
+        return NULL;
+    }
+    stopDisplay();
+    //buffers of this session are returned while callbacks still come here
+    mPlugin->flush();
+    mPlugin->set(PLUGIN_KEY_HIDE_VIDEO, (void *)&hide);
+    int64_t deadlineUs = Tls::Times::getSystemTimeUs() + SESSION_CACHE_PARK_WAIT_MS*1000LL;
+    mReleaseMutex.lock();
+    while (mReleaseFrameCnt < mInFrameCnt) {
+        int64_t leftUs = deadlineUs - Tls::Times::getSystemTimeUs();
+        if (leftUs <= 0) {
+            break;
+        }
+        mReleaseCondition.waitRelativeUs(mReleaseMutex, leftUs);
+    }
+    int notReturnedCnt = mInFrameCnt - mReleaseFrameCnt;
+    mReleaseMutex.unlock();
+    //buffers returned to a parked plugin would never reach app
+    if (notReturnedCnt > 0) {
+        WARNING(mLogCategory,"%d buffers not returned,do not park plugin",notReturnedCnt);
+        return NULL;
+    }
+    mPlugin->setUserData(NULL, &parkedcallback);
+    plugin = mPlugin;
+    mPlugin = NULL;
+    INFO(mLogCategory,"park plugin %p,compositor:%s,pip:%d",plugin,mCompositorName.c_str(),mVideoPip);
+    return plugin;
+}
+
+void RenderCore::attachPlugin(RenderPlugin *plugin, int pip)
+{
+    //plugin created on init is not connected yet,it is kept
+    //in case pip of this session does not match on connect
+    if (mPlugin && !mSparePlugin) {
+        mSparePlugin = mPlugin;
+    } else if (mPlugin) {
+        mPlugin->setUserData(NULL, &parkedcallback);
+        mPlugin->release();
+        delete mPlugin;
+    }
+    mPlugin = plugin;
+    mPlugin->setUserData(this, &plugincallback);
+    mPluginAdopted = true;
+    mAdoptedPip = pip;
+    INFO(mLogCategory,"reuse parked plugin %p,pip:%d",plugin,pip);
+}
+
+RenderPlugin *RenderCore::returnMismatchedPlugin(int *pip)
+{
+    RenderPlugin *plugin;
+
+    if (!mPluginAdopted || mAdoptedPip == mVideoPip || !mSparePlugin) {
+        return NULL;
+    }
+    plugin = mPlugin;
+    plugin->setUserData(NULL, &parkedcallback);
+    *pip = mAdoptedPip;
+    mPlugin = mSparePlugin;
+    mSparePlugin = NULL;
+    mPluginAdopted = false;
+    INFO(mLogCategory,"session cache pip %d not match %d,park plugin %p again",mAdoptedPip,mVideoPip,plugin);
+    return plugin;
+}
+
 int RenderCore::release()
 {
     DEBUG(mLogCategory,"release");
-    if (isRunning()) {
+    if (isDisplayRunning()) {
         DEBUG(mLogCategory,"try stop render frame thread");
-        requestExitAndWait();
+        stopDisplay();
     }
 
     if (mPlugin) {
+        //left opened by disconnect when session cache is enabled
+        if (mPlugin->getState() & PLUGIN_STATE_WINDOW_OPENED) {
+            mPlugin->closeWindow();
+        }
+        if (mPlugin->getState() & PLUGIN_STATE_DISPLAY_OPENED) {
+            mPlugin->closeDisplay();
+        }
         mPlugin->release();
         delete mPlugin;
         mPlugin = NULL;
     }
+    if (mSparePlugin) {
+        mSparePlugin->release();
+        delete mSparePlugin;
+        mSparePlugin = NULL;
+    }
 
     for (auto item = mAllRenderBufferMap.begin(); item != mAllRenderBufferMap.end(); ) {
         RenderBuffer *renderbuf = (RenderBuffer*)item->second;
@@ -170,6 +324,7 @@ int RenderCore::release()
         mMediaSyncBind = false;
     }
 
+    mReorderFrames.clear();
     if (mQueue) {
         mQueue->flush();
         delete mQueue;
@@ -220,6 +375,26 @@ int RenderCore::connect()
         return ERROR_NO_INIT;
     }
 
+    //window of parked plugin is reused if it is the same kind,
+    //geometry of new session is applied with its first frame
+    if (mPluginAdopted) {
+        int hide = 0;
+        mPluginAdopted = false;
+        if (mAdoptedPip == mVideoPip) {
+            INFO(mLogCategory,"reuse window of session cache");
+            if (mSparePlugin) {
+                mSparePlugin->release();
+                delete mSparePlugin;
+                mSparePlugin = NULL;
+            }
+            mPlugin->set(PLUGIN_KEY_HIDE_VIDEO, (void *)&hide);
+            return NO_ERROR;
+        }
+        INFO(mLogCategory,"session cache pip %d not match %d,open window again",mAdoptedPip,mVideoPip);
+        mPlugin->closeWindow();
+        mPlugin->closeDisplay();
+    }
+
     int pluginState = mPlugin->getState();
     if ((pluginState & PLUGIN_STATE_DISPLAY_OPENED) && (pluginState & PLUGIN_STATE_WINDOW_OPENED)) {
         WARNING(mLogCategory,"Render had connected");
@@ -251,14 +426,21 @@ int RenderCore::disconnect()
     //sleep to wait last frame displayed
     //usleep(30000); //is needed?
 
-    if (isRunning()) {
+    if (isDisplayRunning()) {
         DEBUG(mLogCategory,"stop render frame thread");
-        requestExitAndWait();
+        stopDisplay();
     }
 
     if (mQueue) {
         mQueue->flushAndCallback(this, RenderCore::queueFlushCallback);
     }
+    postPacingEvent(PACING_EVENT_RESET);
+
+    //plugin is parked on close,next session reuses its window
+    if (mSessionCache) {
+        DEBUG(mLogCategory,"Disconnect,keep window for session cache");
+        return NO_ERROR;
+    }
 
     if (mPlugin && mPlugin->getState() & PLUGIN_STATE_WINDOW_OPENED) {
         TRACE1(mLogCategory,"try close window");
@@ -275,9 +457,25 @@ int RenderCore::disconnect()
 
 int RenderCore::displayFrame(RenderBuffer *buffer)
 {
-    Tls::Mutex::Autolock _l(mRenderMutex);
+    int ret = inputFrame(buffer);
+    //user callback is not called with mInputMutex held
+    sendDecimationChanged();
+    return ret;
+}
+
+int RenderCore::inputFrame(RenderBuffer *buffer)
+{
+    bool queueFull = false;
+
+    //wait without mInputMutex held,display thread may need it
+    if (mQueueMaxDepth > 0 && mQueueFullPolicy == QUEUE_FULL_POLICY_BLOCK && !mLowLatencyMode && !mStandby) {
+        queueFull = !waitQueueSpace();
+    }
+
+    //queue has its own lock,producer never waits for display thread
+    Tls::Mutex::Autolock _l(mInputMutex);
     //if display thread is not running ,start it
-    if (!isRunning()) {
+    if (!isDisplayRunning()) {
         DEBUG(mLogCategory,"to run displaythread");
         if (!mPlugin) {
             ERROR(mLogCategory,"please set compositor name first");
@@ -289,7 +487,24 @@ int RenderCore::displayFrame(RenderBuffer *buffer)
             return ERROR_NO_INIT;
         }
         //run display thread
-        run("displaythread");
+        startDisplay();
+    }
+
+    if (mQueueMaxDepth > 0 && !mLowLatencyMode && !mStandby && mQueue->getCnt() >= mQueueMaxDepth) {
+        queueFull = true;
+    }
+    if (queueFull) {
+        if (mQueueFullPolicy == QUEUE_FULL_POLICY_RETURN_AGAIN) {
+            TRACE2(mLogCategory,"queue full,return again,buffer:%p",buffer);
+            return ERROR_WOULD_BLOCK;
+        } else if (mQueueFullPolicy != QUEUE_FULL_POLICY_DROP_OLDEST) {
+            WARNING(mLogCategory,"queue full,drop new frame:%p,pts:%lld",buffer,buffer->pts);
+            //counted as input,its release is counted too
+            mInFrameCnt += 1;
+            pluginBufferDropedCallback(this, buffer);
+            pluginBufferReleaseCallback(this, buffer);
+            return NO_ERROR;
+        }
     }
 
     mInFrameCnt += 1;
@@ -297,13 +512,24 @@ int RenderCore::displayFrame(RenderBuffer *buffer)
     TRACE1(mLogCategory,"+++++buffer:%p,ptsUs:%lld,ptsdiff:%d ms",buffer,buffer->pts/1000,(buffer->pts/1000000-mLastInputPTS/1000000));
 
     //if pts is -1,we need calculate it
+    bool ptsExtrapolated = false;
     if (buffer->pts == -1) {
-        if (mVideoFPS > 0) {
-            buffer->pts = mLastInputPTS + TIME_NANO_SEC/mVideoFPS;
+        if (mFrameIntervalNs > 0 && mLastInputPTS >= 0) {
+            buffer->pts = mLastInputPTS + mFrameIntervalNs;
+            ptsExtrapolated = true;
             TRACE2(mLogCategory,"correct pts:%lld",buffer->pts);
         }
     }
 
+    if (mReorderDepth > 0 && !ptsExtrapolated) {
+        reorderFrame(buffer);
+        return NO_ERROR;
+    }
+    return queueFrame(buffer, ptsExtrapolated);
+}
+
+int RenderCore::queueFrame(RenderBuffer *buffer, bool ptsExtrapolated)
+{
     //detect input frame and last input frame pts,if equal, release this frame
     if (mLastInputPTS == buffer->pts) {
         WARNING(mLogCategory,"frame pts equal last frame pts,release this frame:%p, queue size:%d, inFrameCnt:%d",buffer,mQueue->getCnt(),mInFrameCnt);
@@ -315,24 +541,53 @@ int RenderCore::displayFrame(RenderBuffer *buffer)
         return NO_ERROR;
     }
 
-    mQueue->push(buffer);
-    TRACE1(mLogCategory,"queue size:%d, inFrameCnt:%d",mQueue->getCnt(),mInFrameCnt);
+    //fps detect,only real pts are counted
+    if (!ptsExtrapolated) {
+        mFrameRateEstimator.addPts(buffer->pts);
+        updateFrameInterval();
+        //frames from reorder window arrive when they can be queued
+        if (mJitterBufferEnable) {
+            updateJitterTarget(buffer->pts);
+        }
+    }
 
-    //fps detect
-    if (mVideoFPS > 0) {
-        mFPSIntervalMs = mVideoFPS;
-    } else {
-        if (mFPSDetectCnt <= 100) {
-            if (mLastInputPTS > 0) {
-                int internal = buffer->pts/1000000 - mLastInputPTS/1000000;
-                mFPSDetectAcc += internal;
-                mFPSDetectCnt++;
-                mFPSIntervalMs = mFPSDetectAcc/mFPSDetectCnt;
-                TRACE2(mLogCategory,"fps internal:%d ms,cnt:%d,mFPS_internal:%d",internal,mFPSDetectCnt,mFPSIntervalMs);
-            }
+    //latest frame wins,replaced frame is released at once
+    if (mLowLatencyMode) {
+        RenderBuffer *replaced;
+        mRenderMutex.lock();
+        replaced = mLatestFrame;
+        mLatestFrame = buffer;
+        mRenderMutex.unlock();
+        if (replaced) {
+            TRACE2(mLogCategory,"replace frame %p,pts:%lld",replaced,replaced->pts);
+            pluginBufferDropedCallback(this, replaced);
+            pluginBufferReleaseCallback(this, replaced);
         }
+        postPacingEvent(PACING_EVENT_FRAME_QUEUED);
+        mLastInputPTS = buffer->pts;
+        return NO_ERROR;
+    }
+
+    //trick play,release frames that can't be displayed without queuing
+    if (decimateFrame(buffer)) {
+        TRACE2(mLogCategory,"decimate frame %p,pts:%lld",buffer,buffer->pts);
+        pluginBufferDropedCallback(this, buffer);
+        pluginBufferReleaseCallback(this, buffer);
+        mLastInputPTS = buffer->pts;
+        return NO_ERROR;
+    }
+
+    //standby keeps newest frames only,they are shown on promote
+    if (mStandby) {
+        dropOldestFrames(STANDBY_MAX_CACHED_FRAMES);
+    } else if (mQueueMaxDepth > 0 && mQueueFullPolicy == QUEUE_FULL_POLICY_DROP_OLDEST) {
+        dropOldestFrames(mQueueMaxDepth);
     }
 
+    mQueue->push(buffer);
+    TRACE1(mLogCategory,"queue size:%d, inFrameCnt:%d",mQueue->getCnt(),mInFrameCnt);
+    postPacingEvent(PACING_EVENT_FRAME_QUEUED);
+
     mLastInputPTS = buffer->pts;
 
     return NO_ERROR;
@@ -349,37 +604,36 @@ int RenderCore::setProp(int property, void *prop)
     switch (property) {
         case KEY_WINDOW_SIZE: {
             RenderWindowSize *win = (RenderWindowSize *) (prop);
-            mWinSize.x = win->x;
-            mWinSize.y = win->y;
-            mWinSize.w = win->w;
-            mWinSize.h = win->h;
-            DEBUG(mLogCategory,"set window size:x:%d,y:%d,w:%d,h:%d",mWinSize.x,mWinSize.y,mWinSize.w,mWinSize.h);
-            //if window has opened ,set immediately
-            if (mPlugin && mPlugin->getState() & PLUGIN_STATE_WINDOW_OPENED) {
-                PluginRect rect;
-                rect.x = mWinSize.x;
-                rect.y = mWinSize.y;
-                rect.w = mWinSize.w;
-                rect.h = mWinSize.h;
-                mPlugin->set(PLUGIN_KEY_WINDOW_SIZE, &rect);
-            } else {
-                mWinSizeChanged = true;
-            }
+            DEBUG(mLogCategory,"set window size:x:%d,y:%d,w:%d,h:%d",win->x,win->y,win->w,win->h);
+            //plugin is set on display thread,not racing a frame commit
+            Tls::Mutex::Autolock _l(mConfigMutex);
+            mWinSize = *win;
+            postProperties(-1, PROPERTY_CHANGED_WINDOW_SIZE);
         } break;
         case KEY_FRAME_SIZE:{
             RenderFrameSize *frame = (RenderFrameSize *) (prop);
+            DEBUG(mLogCategory,"set frame size:w:%d,h:%d",frame->frameWidth,frame->frameHeight);
+            Tls::Mutex::Autolock _l(mConfigMutex);
             mFrameWidth = frame->frameWidth;
             mFrameHeight = frame->frameHeight;
-            DEBUG(mLogCategory,"set frame size:w:%d,h:%d",mFrameWidth,mFrameHeight);
-            //if window has opened ,set immediately
-            if (mPlugin && mPlugin->getState() & PLUGIN_STATE_WINDOW_OPENED) {
-                PluginFrameSize size;
-                size.w = mFrameWidth;
-                size.h = mFrameHeight;
-                mPlugin->set(PLUGIN_KEY_FRAME_SIZE, &size);
-            } else {
-                mFrameChanged = true;
-            }
+            postProperties(-1, PROPERTY_CHANGED_FRAME_SIZE);
+        } break;
+        case KEY_WINDOW_SIZE_AT_PTS: {
+            RenderWindowSizeAtPts *win = (RenderWindowSizeAtPts *) (prop);
+            TRACE1(mLogCategory,"set window size:x:%d,y:%d,w:%d,h:%d at pts:%lld",
+                win->winSize.x,win->winSize.y,win->winSize.w,win->winSize.h,win->pts);
+            Tls::Mutex::Autolock _l(mConfigMutex);
+            mWinSize = win->winSize;
+            postProperties(win->pts, PROPERTY_CHANGED_WINDOW_SIZE);
+        } break;
+        case KEY_FRAME_SIZE_AT_PTS: {
+            RenderFrameSizeAtPts *frame = (RenderFrameSizeAtPts *) (prop);
+            DEBUG(mLogCategory,"set frame size:w:%d,h:%d at pts:%lld",
+                frame->frameSize.frameWidth,frame->frameSize.frameHeight,frame->pts);
+            Tls::Mutex::Autolock _l(mConfigMutex);
+            mFrameWidth = frame->frameSize.frameWidth;
+            mFrameHeight = frame->frameSize.frameHeight;
+            postProperties(frame->pts, PROPERTY_CHANGED_FRAME_SIZE);
         } break;
         case KEY_MEDIASYNC_INSTANCE_ID: {
             mMediaSynInstID = *(int *)(prop);
@@ -409,12 +663,15 @@ int RenderCore::setProp(int property, void *prop)
             int64_t fps = *(int64_t *)prop;
             mVideoFPS_N = int ((fps >> 32) & 0xFFFFFFFF);
             mVideoFPS_D = int (fps & 0xFFFFFFFF);
-            mVideoFPS = (int) mVideoFPS_N/mVideoFPS_D;
+            mVideoFPS = mVideoFPS_D > 0? (int) mVideoFPS_N/mVideoFPS_D : 0;
             DEBUG(mLogCategory,"set video fps_n:%d(%x),fps_d:%d(%x),fps:%d",mVideoFPS_N,mVideoFPS_N,mVideoFPS_D,mVideoFPS_D,mVideoFPS);
+            Tls::Mutex::Autolock _l(mInputMutex);
+            updateFrameInterval();
         } break;
         case KEY_VIDEO_PIP: {
             int pip = *(int *)(prop);
             DEBUG(mLogCategory,"set video pip :%d",pip);
+            mVideoPip = pip;
             if (mPlugin) {
                 mPlugin->set(PLUGIN_KEY_VIDEO_PIP, (void *)&pip);
             }
@@ -471,6 +728,7 @@ int RenderCore::setProp(int property, void *prop)
                 if (mMediasyncVideoWorkMode.value == VIDEO_WORK_MODE_CACHING_ONLY &&
                         mMediaSyncTunnelmode.value == 1) {
                     Tls::Mutex::Autolock _l(mRenderMutex);
+                    waitDisplayIdleLocked();
                     DEBUG(mLogCategory,"do flush queue buffers");
                     mQueue->flushAndCallback(this, RenderCore::queueFlushCallback);
                 }
@@ -500,12 +758,106 @@ int RenderCore::setProp(int property, void *prop)
         } break;
         case KEY_MEDIASYNC_PLAYBACK_RATE: {
             float rateValue = *(float *)(prop);
+            setPlaybackRateLocal(rateValue);
             if (rateValue >= 0.0f) {
                 if (mMediaSync && mMediaSyncBind) {
                     MediaSync_setPlaybackRate(mMediaSync, rateValue);
                 }
             }
         } break;
+        case KEY_LOW_LATENCY_MODE: {
+            bool lowLatency = *(int *)(prop) > 0? true : false;
+            DEBUG(mLogCategory,"set low latency mode:%d",lowLatency);
+            Tls::Mutex::Autolock _l(mRenderMutex);
+            waitDisplayIdleLocked();
+            //frames queued in normal mode are not needed any more
+            if (lowLatency && !mLowLatencyMode) {
+                mQueue->flushAndCallback(this, RenderCore::queueFlushCallback);
+            }
+            if (!lowLatency && mLatestFrame) {
+                queueFlushCallback(this, mLatestFrame);
+                mLatestFrame = NULL;
+            }
+            mLowLatencyMode = lowLatency;
+        } break;
+        case KEY_QUEUE_MAX_DEPTH: {
+            int depth = *(int *)(prop);
+            if (depth < 0) {
+                ERROR(mLogCategory,"invalid queue max depth:%d",depth);
+                return ERROR_BAD_VALUE;
+            }
+            DEBUG(mLogCategory,"set queue max depth:%d",depth);
+            mQueueMaxDepth = depth;
+        } break;
+        case KEY_QUEUE_FULL_POLICY: {
+            int policy = *(int *)(prop);
+            if (policy < QUEUE_FULL_POLICY_BLOCK || policy > QUEUE_FULL_POLICY_RETURN_AGAIN) {
+                ERROR(mLogCategory,"invalid queue full policy:%d",policy);
+                return ERROR_BAD_VALUE;
+            }
+            DEBUG(mLogCategory,"set queue full policy:%d",policy);
+            mQueueFullPolicy = policy;
+        } break;
+        case KEY_SHARED_SCHEDULER: {
+            bool shared = *(int *)(prop) > 0? true : false;
+            if (isDisplayRunning()) {
+                ERROR(mLogCategory,"set shared scheduler after display started");
+                return ERROR_INVALID_OPERATION;
+            }
+            DEBUG(mLogCategory,"set shared scheduler:%d",shared);
+            mSharedScheduler = shared;
+        } break;
+        case KEY_STANDBY: {
+            bool standby = *(int *)(prop) > 0? true : false;
+            if (!standby) {
+                return promote();
+            }
+            int hide = 1;
+            DEBUG(mLogCategory,"set standby");
+            if (mPlugin) {
+                mPlugin->set(PLUGIN_KEY_HIDE_VIDEO, (void *)&hide);
+            }
+            Tls::Mutex::Autolock _l(mInputMutex);
+            mStandby = true;
+        } break;
+        case KEY_QOS_INTERVAL: {
+            int interval = *(int *)(prop);
+            if (interval < 0) {
+                ERROR(mLogCategory,"invalid qos interval:%d",interval);
+                return ERROR_BAD_VALUE;
+            }
+            DEBUG(mLogCategory,"set qos interval:%d ms",interval);
+            mQosIntervalMs = interval;
+        } break;
+        case KEY_JITTER_BUFFER: {
+            bool enable = *(int *)(prop) > 0? true : false;
+            DEBUG(mLogCategory,"set jitter buffer:%d",enable);
+            Tls::Mutex::Autolock _l(mInputMutex);
+            if (enable && !mJitterBufferEnable) {
+                mJitterEstimator.reset();
+                mJitterTargetDepth = 1;
+                mJitterShrinkTimeUs = 0;
+            }
+            mJitterBufferEnable = enable;
+        } break;
+        case KEY_FAST_FIRST_FRAME: {
+            mFastFirstFrame = *(int *)(prop) > 0? true : false;
+            DEBUG(mLogCategory,"set fast first frame:%d",mFastFirstFrame);
+        } break;
+        case KEY_REORDER_DEPTH: {
+            int depth = *(int *)(prop);
+            if (depth < 0 || depth > MAX_REORDER_DEPTH) {
+                ERROR(mLogCategory,"invalid reorder depth:%d,max is %d",depth,MAX_REORDER_DEPTH);
+                return ERROR_BAD_VALUE;
+            }
+            DEBUG(mLogCategory,"set reorder depth:%d",depth);
+            Tls::Mutex::Autolock _l(mInputMutex);
+            mReorderDepth = depth;
+            //window shrinks,emit frames over new depth
+            while ((int)mReorderFrames.size() > mReorderDepth) {
+                emitReorderedFrameLocked();
+            }
+        } break;
         case KEY_FORCE_ASPECT_RATIO: {
             int forceAspectRatio = *(int *)(prop);
             DEBUG(mLogCategory,"set force aspect ratio:%d",forceAspectRatio);
@@ -530,6 +882,7 @@ int RenderCore::getProp(int property, void *prop)
     switch (property) {
         case KEY_WINDOW_SIZE: {
             RenderWindowSize *win = (RenderWindowSize *) prop;
+            Tls::Mutex::Autolock _l(mConfigMutex);
             win->x = mWinSize.x;
             win->y = mWinSize.y;
             win->w = mWinSize.w;
@@ -538,6 +891,7 @@ int RenderCore::getProp(int property, void *prop)
         } break;
         case KEY_FRAME_SIZE: {
             RenderFrameSize *frame = (RenderFrameSize *) prop;
+            Tls::Mutex::Autolock _l(mConfigMutex);
             frame->frameWidth = mFrameWidth;
             frame->frameHeight = mFrameHeight;
             TRACE1(mLogCategory,"get prop frame size:w:%d,h:%d",mFrameWidth,mFrameHeight);
@@ -591,6 +945,7 @@ int RenderCore::getProp(int property, void *prop)
                 if (mMediasyncVideoWorkMode.value == VIDEO_WORK_MODE_CACHING_ONLY &&
                         mMediaSyncTunnelmode.value == 1) {
                     Tls::Mutex::Autolock _l(mRenderMutex);
+                    waitDisplayIdleLocked();
                     DEBUG(mLogCategory,"do flush queue buffers");
                     mQueue->flushAndCallback(this, RenderCore::queueFlushCallback);
                 }
@@ -611,6 +966,37 @@ int RenderCore::getProp(int property, void *prop)
         case KEY_FRAME_DROPPED: {
             *(int *)prop = mDropFrameCnt;
         } break;
+        case KEY_LOW_LATENCY_MODE: {
+            *(int *)prop = mLowLatencyMode? 1 : 0;
+        } break;
+        case KEY_FAST_FIRST_FRAME: {
+            *(int *)prop = mFastFirstFrame? 1 : 0;
+        } break;
+        case KEY_QUEUE_MAX_DEPTH: {
+            *(int *)prop = mQueueMaxDepth;
+        } break;
+        case KEY_QUEUE_FULL_POLICY: {
+            *(int *)prop = mQueueFullPolicy;
+        } break;
+        case KEY_SHARED_SCHEDULER: {
+            *(int *)prop = mSharedScheduler? 1 : 0;
+        } break;
+        case KEY_STANDBY: {
+            *(int *)prop = mStandby? 1 : 0;
+        } break;
+        case KEY_QOS_INTERVAL: {
+            *(int *)prop = mQosIntervalMs;
+        } break;
+        case KEY_JITTER_BUFFER: {
+            *(int *)prop = mJitterBufferEnable? 1 : 0;
+        } break;
+        case KEY_REORDER_DEPTH: {
+            *(int *)prop = mReorderDepth;
+        } break;
+        case KEY_DISPLAY_CADENCE: {
+            Tls::Mutex::Autolock _l(mConfigMutex);
+            *(RenderDisplayCadence *)prop = mCadence;
+        } break;
         case KEY_MEDIASYNC_HAS_AUDIO: {
             *(int *)prop = mMediasyncHasAudio.value;
         } break;
@@ -646,34 +1032,70 @@ int RenderCore::getProp(int property, void *prop)
 int RenderCore::flush()
 {
     DEBUG(mLogCategory,"flush start");
+    //input side first,mInputMutex must not be taken under mRenderMutex
+    flushReorderWindow();
     Tls::Mutex::Autolock _l(mRenderMutex);
-    mFlushing = true;
-    mQueue->flushAndCallback(this, RenderCore::queueFlushCallback);
-    mMediaSyncAnchor = false;
-    //flush plugin
-    if (mPlugin) {
-        mPlugin->flush();
+    postPacingEvent(PACING_EVENT_FLUSH_START);
+    //wait the frame being displayed,so queue head is not taken now
+    waitDisplayIdleLocked();
+    //frames in queue now are old generation,display thread releases
+    //them and flushes plugin,caller does not wait for old pipeline
+    mGeneration++;
+    mStaleFrameCnt = mQueue->getCnt();
+    mPluginFlushPending = true;
+    if (mLatestFrame) {
+        queueFlushCallback(this, mLatestFrame);
+        mLatestFrame = NULL;
     }
+    mMediaSyncAnchor = false;
 
     if (mMediaSync && mMediaSyncBind) {
         MediaSync_reset(mMediaSync);
     }
 
-    mFlushing = false;
+    requestFreeRunReanchor();
     mWaitAnchorTimeUs = 0;
-    DEBUG(mLogCategory,"flush end");
+    //first frame of new generation is prerolled again
+    postPacingEvent(PACING_EVENT_FLUSH_END);
+    DEBUG(mLogCategory,"flush end,generation:%d,stale frames:%d",mGeneration,mStaleFrameCnt);
+    return NO_ERROR;
+}
+
+int RenderCore::promote()
+{
+    int hide = 0;
+
+    if (!mStandby) {
+        WARNING(mLogCategory,"not standby");
+        return NO_ERROR;
+    }
+    INFO(mLogCategory,"promote,cached frames:%d",mQueue->getCnt());
+    if (mPlugin) {
+        mPlugin->set(PLUGIN_KEY_HIDE_VIDEO, (void *)&hide);
+    }
+    //older cached frames are stale on channel change,keep newest
+    //one only,standby displayed nothing so it is prerolled,producer
+    //must not queue between drop and standby left
+    mInputMutex.lock();
+    dropOldestFrames(2);
+    mStandby = false;
+    mInputMutex.unlock();
+    wakeupDisplayThread();
     return NO_ERROR;
 }
 
 int RenderCore::pause()
 {
     DEBUG(mLogCategory,"Pause");
-    if (mPaused) {
+    mLimitMutex.lock();
+    bool paused = mPacing.isPaused();
+    mLimitMutex.unlock();
+    if (paused) {
         WARNING(mLogCategory, "had paused");
         return NO_ERROR;
     }
 
-    mPaused = true;
+    postPacingEvent(PACING_EVENT_PAUSE);
     if (mMediaSync && mMediaSyncBind) {
         mediasync_result ret = MediaSync_setPause(mMediaSync, true);
         if (ret != AM_MEDIASYNC_OK) {
@@ -691,12 +1113,17 @@ int RenderCore::pause()
 int RenderCore::resume()
 {
     DEBUG(mLogCategory,"Resume");
-    if (mPaused == false) {
+    mLimitMutex.lock();
+    bool paused = mPacing.isPaused();
+    mLimitMutex.unlock();
+    if (!paused) {
         WARNING(mLogCategory, "had resumed");
         return NO_ERROR;
     }
 
-    mPaused = false;
+    //paused time must not count in free run clock
+    requestFreeRunReanchor();
+    postPacingEvent(PACING_EVENT_RESUME);
     if (mMediaSync && mMediaSyncBind) {
         mediasync_result ret = MediaSync_setPause(mMediaSync, false);
         if (ret != AM_MEDIASYNC_OK) {
@@ -814,6 +1241,7 @@ int RenderCore::setPlaybackRate(float scale)
 {
     mediasync_result ret;
 
+    setPlaybackRateLocal(scale);
     if (mMediaSync && mMediaSyncBind) {
         ret = MediaSync_setPlaybackRate(mMediaSync, scale);
         if (ret != AM_MEDIASYNC_OK) {
@@ -844,7 +1272,7 @@ int RenderCore::queueDemuxPts(int64_t ptsUs, uint32_t size)
 void RenderCore::pluginMsgCallback(void *handle, int msg, void *detail)
 {
     RenderCore* renderCore = static_cast<RenderCore *>(handle);
-    DEBUG(renderCore->mLogCategory,"pluginMsgCallback,msg:%d",msg);
+    TRACE3(renderCore->mLogCategory,"pluginMsgCallback,msg:%d",msg);
     switch (msg) {
         case PLUGIN_MSG_DISPLAY_OPEN_FAIL:
         case PLUGIN_MSG_WINDOW_OPEN_FAIL:
@@ -852,6 +1280,17 @@ void RenderCore::pluginMsgCallback(void *handle, int msg, void *detail)
                 renderCore->mCallback->doMsgSend(renderCore->mUserData, MSG_CONNECTED_FAIL, NULL);
             }
         break;
+        case PLUGIN_MSG_FRAME_PRESENTED:
+            renderCore->updateDisplayLatency((PluginFramePresented *)detail);
+        break;
+        case PLUGIN_MSG_DISPLAY_MODE_CHANGED: {
+            PluginDisplayMode *mode = (PluginDisplayMode *)detail;
+            INFO(renderCore->mLogCategory,"display mode changed,refresh rate:%d mHz",mode->refreshRate);
+            renderCore->mConfigMutex.lock();
+            renderCore->mCadence.refreshRate = mode->refreshRate;
+            renderCore->mConfigMutex.unlock();
+            renderCore->updateCadence();
+        } break;
         default:
             break;
     }
@@ -861,10 +1300,18 @@ void RenderCore::pluginBufferReleaseCallback(void *handle,void *data)
 {
     RenderCore* renderCore = static_cast<RenderCore *>(handle);
     if (renderCore->mCallback) {
+        renderCore->mReleaseMutex.lock();
         renderCore->mReleaseFrameCnt += 1;
+        //session close waits all buffers back before parking plugin
+        renderCore->mReleaseCondition.broadcast();
+        renderCore->mReleaseMutex.unlock();
         TRACE1(renderCore->mLogCategory,"release buffer %p, pts:%lld,cnt:%d",data,((RenderBuffer *)data)->pts,renderCore->mReleaseFrameCnt);
         renderCore->mCallback->doMsgSend(renderCore->mUserData, MSG_RELEASE_BUFFER, data);
     }
+    //compositor may take next frame now
+    if (renderCore->mLowLatencyMode) {
+        renderCore->wakeupDisplayThread();
+    }
 }
 
 void RenderCore::pluginBufferDisplayedCallback(void *handle,void *data)
@@ -894,144 +1341,897 @@ void RenderCore::queueFlushCallback(void *userdata,void *data)
     pluginBufferReleaseCallback(renderCore, data);
 }
 
-int64_t RenderCore::nanosecToPTS90K(int64_t nanosec)
+void RenderCore::updateDisplayLatency(PluginFramePresented *presented)
 {
-    return (nanosec / 100) * 9;
-}
+    int64_t errorUs;
+    int64_t latencyUs;
 
-void RenderCore::setMediasyncPropertys()
-{
-    //set mediasync source type
-    if (mMediaSync && mMediaSyncBind && mMediasyncSourceType.changed) {
-        INFO(mLogCategory,"do set mediasync source type: %d",mMediasyncSourceType);
-        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_SOURCETYPE, (void* )&mMediasyncSourceType);
+    if (!presented || presented->displayTimeUs <= 0) {
+        return;
     }
 
-    //set mediasync has audio
-    if (mMediaSync && mMediaSyncBind && mMediasyncHasAudio.changed) {
-        INFO(mLogCategory,"do set mediasync has audio: %d",mMediasyncHasAudio.value);
-         mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_HASAUDIO, (void* )&mMediasyncHasAudio.value);
+    //frames are submitted the estimate ahead of scheduled time,
+    //error against scheduled time closes the loop on the estimate
+    errorUs = presented->presentedTimeUs - presented->displayTimeUs;
+    //ignore frames held by compositor,e.g. paused
+    if (errorUs > MAX_LATENCY_TO_HDMI_TIME_US || errorUs < -MAX_LATENCY_TO_HDMI_TIME_US) {
+        TRACE2(mLogCategory,"ignore presentation error %lld us",errorUs);
+        return;
     }
 
-    //set mediasync video latency
-    if (mMediaSync && mMediaSyncBind && mMediasyncVideoLatency.changed) {
-        INFO(mLogCategory,"do set mediasync video latency: %d",mMediasyncVideoLatency);
-        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_VIDEOLATENCY, (void* )&mMediasyncVideoLatency.value);
+    //early frames are held to their time and never show negative
+    //error,so error below target decays the estimate
+    latencyUs = mDisplayLatencyUs + (errorUs - LATENCY_TARGET_ERROR_US) / LATENCY_ESTIMATE_WEIGHT;
+    if (latencyUs < 0) {
+        latencyUs = 0;
+    } else if (latencyUs > MAX_LATENCY_TO_HDMI_TIME_US) {
+        latencyUs = MAX_LATENCY_TO_HDMI_TIME_US;
     }
+    mDisplayLatencyUs = (int)latencyUs;
+    TRACE2(mLogCategory,"presented pts:%lld,to scheduled:%lld us,estimate:%d us,submit to presented:%lld us",
+        presented->buffer? presented->buffer->pts: -1,errorUs,(int)latencyUs,
+        presented->submitTimeUs > 0? presented->presentedTimeUs - presented->submitTimeUs: -1);
+}
 
-    //set mediasync start threshold
-    if (mMediaSync && mMediaSyncBind && mMediasyncStartThreshold.changed) {
-        INFO(mLogCategory,"do set mediasync start threshold: %d",mMediasyncStartThreshold.value);
-        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_STARTTHRESHOLD, (void* )&mMediasyncStartThreshold.value);
+void RenderCore::updateFrameInterval()
+{
+    int64_t intervalNs = mFrameRateEstimator.getIntervalNs();
+
+    //estimate follows content rate changes,trust it when it is stable,
+    //otherwise user set fps is used
+    if (mFrameRateEstimator.getConfidence() < FPS_ESTIMATE_MIN_CONFIDENCE &&
+        mVideoFPS_N > 0 && mVideoFPS_D > 0) {
+        intervalNs = (int64_t)TIME_NANO_SEC * mVideoFPS_D / mVideoFPS_N;
+    }
+
+    if (intervalNs != mFrameIntervalNs) {
+        TRACE2(mLogCategory,"frame interval %lld ns -> %lld ns,confidence:%d,pulldown:%d",
+            mFrameIntervalNs,intervalNs,mFrameRateEstimator.getConfidence(),
+            mFrameRateEstimator.isPulldownCadence());
+        mFrameIntervalNs = intervalNs;
+        //estimate moves a little on every frame,check cadence again
+        //only if content rate changes more than 0.1%
+        int contentRate = intervalNs > 0? (int)(1000000000000LL / intervalNs) : 0;
+        mConfigMutex.lock();
+        int rateDiff = contentRate - mCadence.contentRate;
+        bool rateChanged = (int64_t)(rateDiff > 0? rateDiff : -rateDiff) * 1000 > mCadence.contentRate;
+        if (rateChanged) {
+            mCadence.contentRate = contentRate;
+        }
+        mConfigMutex.unlock();
+        if (rateChanged) {
+            updateCadence();
+        }
     }
 }
 
-void RenderCore::waitTimeoutUs(int64_t timeoutMs)
+bool RenderCore::waitQueueSpace()
 {
-    Tls::Mutex::Autolock _l(mLimitMutex);
-    mLimitCondition.waitRelativeUs(mLimitMutex, timeoutMs);
+    int64_t deadlineUs = Tls::Times::getSystemTimeUs() + QUEUE_FULL_BLOCK_TIMEOUT_US;
+
+    //display thread broadcasts idle condition after each display pass
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    while (mQueue->getCnt() >= mQueueMaxDepth) {
+        int64_t nowUs = Tls::Times::getSystemTimeUs();
+        if (nowUs >= deadlineUs) {
+            return false;
+        }
+        mDisplayIdleCondition.waitRelativeUs(mRenderMutex, deadlineUs - nowUs);
+    }
+    return true;
 }
 
-void RenderCore::mediaSyncTunnelmodeDisplay()
+void RenderCore::dropOldestFrames(int maxDepth)
 {
-    mediasync_result ret;
-    int64_t nowSystemtimeUs; //us unit
-    int64_t nowMediasyncTimeUs; //us unit
-    int64_t realtimeUs; //us unit
-    int64_t delaytimeUs; //us unit
-    int64_t nowPts;
-    RenderBuffer *buf;
-    int qRet;
-    int64_t needWaitTimeUs = 0;
+    std::vector<RenderBuffer *> dropFrames;
+    RenderBuffer *buf = NULL;
 
     mRenderMutex.lock();
-    if (!mMediaSync || !mMediaSyncBind) {
-        WARNING(mLogCategory,"No create mediasync or no init mediasync");
-        goto Err_tag;
+    //queue head may be displaying now
+    waitDisplayIdleLocked();
+    while (mQueue->getCnt() >= maxDepth && mQueue->pop((void **)&buf) == Q_OK) {
+        if (mStaleFrameCnt > 0) {
+            mStaleFrameCnt--;
+        }
+        dropFrames.push_back(buf);
     }
+    mRenderMutex.unlock();
 
-    qRet = mQueue->peek((void **) &buf, 0);
-    if (qRet != Q_OK) {
-        WARNING(mLogCategory, "pop item from queue failed");
-        goto Err_tag;
+    for (size_t i = 0; i < dropFrames.size(); i++) {
+        if (mStandby) {
+            TRACE2(mLogCategory,"standby,drop oldest frame:%p,pts:%lld",dropFrames[i],dropFrames[i]->pts);
+        } else {
+            WARNING(mLogCategory,"queue full,drop oldest frame:%p,pts:%lld",dropFrames[i],dropFrames[i]->pts);
+        }
+        pluginBufferDropedCallback(this, dropFrames[i]);
+        pluginBufferReleaseCallback(this, dropFrames[i]);
     }
+}
 
-    nowPts = buf->pts;
+static bool comparePtsGreater(RenderBuffer *a, RenderBuffer *b)
+{
+    return a->pts > b->pts;
+}
 
-    //update mediasync pts when vmaster
-    if (mSyncmode == MEDIA_SYNC_VMASTER) {
-        if ( mMediaSyncAnchor == false) {
-            mMediaSyncAnchor = true;
-            INFO(mLogCategory,"anchor pts:%lld",nowPts);
-            if (nowPts == 0) { //if pts is 0, mediasync do not update realtime,so workround
-                MediaSync_updateAnchor(mMediaSync, 2*1000, 0, 0);
-            } else {
-                MediaSync_updateAnchor(mMediaSync, nowPts/1000, 0, 0);
-            }
-        }
+void RenderCore::reorderFrame(RenderBuffer *buffer)
+{
+    mLastReorderInputUs = Tls::Times::getSystemTimeUs();
+
+    //backward jump far from emitted frames is a new pts sequence,
+    //emit frames of old sequence first
+    if (mLastEmittedPts >= 0 && buffer->pts < mLastEmittedPts - REORDER_DISCONTINUITY_THRESHOLD_NS) {
+        WARNING(mLogCategory,"pts discontinuity,pts:%lld,last emitted pts:%lld",buffer->pts,mLastEmittedPts);
+        drainReorderWindowLocked();
+        mLastEmittedPts = -1;
     }
 
-    //get video frame display time
-    if (nowPts == 0) {
-        ret = MediaSync_getRealTimeFor(mMediaSync, 2*1000/*us*/, &realtimeUs);
-    } else {
-        ret = MediaSync_getRealTimeFor(mMediaSync, nowPts/1000/*us*/, &realtimeUs);
+    //duplicated pts anywhere in window,or too late to be emitted in order
+    bool drop = (mLastEmittedPts >= 0 && buffer->pts <= mLastEmittedPts);
+    for (size_t i = 0; !drop && i < mReorderFrames.size(); i++) {
+        if (mReorderFrames[i]->pts == buffer->pts) {
+            drop = true;
+        }
     }
-    if (ret != AM_MEDIASYNC_OK) {
-        WARNING(mLogCategory,"get mediasync realtime fail");
-        realtimeUs = -1;
+    if (drop) {
+        WARNING(mLogCategory,"drop duplicated or late frame:%p,pts:%lld,last emitted pts:%lld",buffer,buffer->pts,mLastEmittedPts);
+        pluginBufferDropedCallback(this, buffer);
+        pluginBufferReleaseCallback(this, buffer);
+        return;
     }
 
-    //get systemtime
-    nowSystemtimeUs = Tls::Times::getSystemTimeUs();
-    //get mediasync systemtime
-    ret = MediaSync_getRealTimeForNextVsync(mMediaSync, &nowMediasyncTimeUs);
-    if (ret != AM_MEDIASYNC_OK) {
-        WARNING(mLogCategory,"get mediasync time fail");
+    mReorderFrames.push_back(buffer);
+    std::push_heap(mReorderFrames.begin(), mReorderFrames.end(), comparePtsGreater);
+    while ((int)mReorderFrames.size() > mReorderDepth) {
+        emitReorderedFrameLocked();
     }
+}
 
-    delaytimeUs = realtimeUs - nowMediasyncTimeUs - LATENCY_TO_HDMI_TIME_US;
+void RenderCore::emitReorderedFrameLocked()
+{
+    RenderBuffer *buf;
 
-    if (delaytimeUs <= 0) {
-        if (realtimeUs < 0) {
-            if (mSyncmode == MEDIA_SYNC_AMASTER) {
-                if (mWaitAnchorTimeUs < WAIT_AUDIO_TIME_US) {
-                    mWaitAnchorTimeUs += 2000;
-                    WARNING(mLogCategory,"waited audio anchor mediasync %d us",mWaitAnchorTimeUs);
-                    needWaitTimeUs = 2000;
-                    goto Block_tag;
-                } else {
-                    WARNING(mLogCategory,"wait audio anchor mediasync timeout, use vmaster");
-                    MediaSync_setSyncMode(mMediaSync, MEDIA_SYNC_VMASTER);
-                    mSyncmode = MEDIA_SYNC_VMASTER;
-                    mWaitAnchorTimeUs = 0;
-                    goto Err_tag;
-                }
-            }
-            if (mSyncmode == MEDIA_SYNC_VMASTER) {
-                mWaitAnchorTimeUs += 2000;
-                WARNING(mLogCategory,"video had anchored mediasync,wait realtm %d us",mWaitAnchorTimeUs);
-                needWaitTimeUs = 2000;
-                goto Block_tag;
-            }
+    std::pop_heap(mReorderFrames.begin(), mReorderFrames.end(), comparePtsGreater);
+    buf = mReorderFrames.back();
+    mReorderFrames.pop_back();
+    mLastEmittedPts = buf->pts;
+    queueFrame(buf, false);
+}
 
-            /*use pts diff to send frame displaying,when get realtime fail,
-            the first frame send imediately,but other frames will send
+void RenderCore::drainReorderWindowLocked()
+{
+    while (!mReorderFrames.empty()) {
+        emitReorderedFrameLocked();
+    }
+}
+
+int64_t RenderCore::drainReorderWindow()
+{
+    Tls::Mutex::Autolock _l(mInputMutex);
+    if (mReorderFrames.empty()) {
+        return 0;
+    }
+    //no more input,e.g. end of stream,emit frames left in window
+    int64_t drainUs = mLastReorderInputUs + REORDER_DRAIN_TIME_US;
+    if (Tls::Times::getSystemTimeUs() >= drainUs) {
+        TRACE2(mLogCategory,"no input,drain %d frames in reorder window",(int)mReorderFrames.size());
+        drainReorderWindowLocked();
+        return 0;
+    }
+    return drainUs;
+}
+
+void RenderCore::flushReorderWindow()
+{
+    Tls::Mutex::Autolock _l(mInputMutex);
+    for (size_t i = 0; i < mReorderFrames.size(); i++) {
+        queueFlushCallback(this, mReorderFrames[i]);
+    }
+    mReorderFrames.clear();
+    mLastEmittedPts = -1;
+    mLastKeptPts = -1;
+    //arrival of new position is not related to old one,
+    //target depth is kept,network jitter does not change
+    mJitterEstimator.reset();
+}
+
+bool RenderCore::decimateFrame(RenderBuffer *buffer)
+{
+    float rate;
+    int refreshRate;
+    int64_t minIntervalNs = 0;
+
+    mConfigMutex.lock();
+    rate = mPlaybackRate;
+    refreshRate = mCadence.refreshRate > 0? mCadence.refreshRate : DEFAULT_DISPLAY_REFRESH_RATE_MHZ;
+    mConfigMutex.unlock();
+
+    //display shows at most one frame every vsync,frames closer than
+    //rate*vsync in pts can't all be displayed
+    if (rate > 1.0f) {
+        minIntervalNs = (int64_t)(rate * (1000000000000LL / refreshRate));
+    }
+    if (minIntervalNs != mDecimateIntervalNs) {
+        INFO(mLogCategory,"decimation interval %lld ns -> %lld ns,rate:%f,refresh:%d mHz",
+            mDecimateIntervalNs,minIntervalNs,rate,refreshRate);
+        mDecimateIntervalNs = minIntervalNs;
+        mLastKeptPts = -1;
+        //let decoder skip non-reference frames upstream,sent after unlock
+        mDecimationChanged = true;
+    }
+
+    if (mDecimateIntervalNs <= 0 || buffer->pts < 0) {
+        return false;
+    }
+    //keep first frame and frames after pts discontinuity
+    if (mLastKeptPts < 0 || buffer->pts < mLastKeptPts ||
+        buffer->pts - mLastKeptPts >= mDecimateIntervalNs - mDecimateIntervalNs/8) {
+        mLastKeptPts = buffer->pts;
+        return false;
+    }
+    return true;
+}
+
+void RenderCore::sendDecimationChanged()
+{
+    int64_t intervalNs;
+
+    if (!mDecimationChanged.exchange(false)) {
+        return;
+    }
+    mInputMutex.lock();
+    intervalNs = mDecimateIntervalNs;
+    mInputMutex.unlock();
+    if (mCallback) {
+        mCallback->doMsgSend(mUserData, MSG_DECIMATION_CHANGED, &intervalNs);
+    }
+}
+
+void RenderCore::updateCadence()
+{
+    int64_t vsyncs = 0;
+    int64_t lastVsync = 0;
+    int requestRate = 0;
+
+    mConfigMutex.lock();
+    RenderDisplayCadence *cadence = &mCadence;
+    int contentRate = cadence->contentRate;
+    int refreshRate = cadence->refreshRate;
+
+    cadence->preferredRefreshRate = 0;
+    cadence->judder = 0;
+    memset(cadence->pattern, 0, sizeof(cadence->pattern));
+    if (contentRate <= 0) {
+        mConfigMutex.unlock();
+        return;
+    }
+
+    //same rate or the least integer multiple that display supports
+    cadence->preferredRefreshRate = contentRate;
+    while (cadence->preferredRefreshRate < MIN_DISPLAY_REFRESH_RATE_MHZ) {
+        cadence->preferredRefreshRate += contentRate;
+    }
+
+    if (refreshRate > 0) {
+        //frame k is displayed from vsync k*refresh/content
+        for (int i = 0; i < RENDER_CADENCE_PATTERN_LEN; i++) {
+            vsyncs = (int64_t)(i + 1) * refreshRate / contentRate;
+            cadence->pattern[i] = (int)(vsyncs - lastVsync);
+            lastVsync = vsyncs;
+            if (cadence->pattern[i] != cadence->pattern[0]) {
+                cadence->judder = 1;
+            }
+        }
+        //refresh rate is not integer multiple of content rate
+        if (!cadence->judder && (int64_t)cadence->pattern[0] * contentRate * 1000 / refreshRate != 1000) {
+            cadence->judder = 1;
+        }
+        INFO(mLogCategory,"content %d mHz on display %d mHz,judder:%d,pattern:%d:%d:%d:%d:%d",
+            contentRate,refreshRate,cadence->judder,cadence->pattern[0],cadence->pattern[1],
+            cadence->pattern[2],cadence->pattern[3],cadence->pattern[4]);
+        if (cadence->judder && cadence->preferredRefreshRate != mRequestedRefreshRate) {
+            requestRate = cadence->preferredRefreshRate;
+            mRequestedRefreshRate = requestRate;
+        }
+    }
+    mConfigMutex.unlock();
+
+    if (requestRate > 0 && mCallback) {
+        INFO(mLogCategory,"request display refresh rate %d mHz",requestRate);
+        mCallback->doMsgSend(mUserData, MSG_DISPLAY_REFRESH_RATE_REQUEST, &requestRate);
+    }
+}
+
+void RenderCore::postProperties(int64_t pts, uint32_t changed)
+{
+    PropertySnapshot snapshot;
+
+    //only changed fields are applied,a targeted change is not
+    //leaked by other changes posted before its frame
+    snapshot.version = ++mPropertyVersion;
+    snapshot.pts = pts;
+    snapshot.changed = changed;
+    snapshot.winSize = mWinSize;
+    snapshot.frameWidth = mFrameWidth;
+    snapshot.frameHeight = mFrameHeight;
+    mPropertyMailbox.post(&snapshot);
+    wakeupDisplayThread();
+}
+
+void RenderCore::applyProperties(int64_t pts, bool force)
+{
+    PropertySnapshot props;
+
+    //targeted changes wait the first frame reaching target pts
+    if (!mPlugin || !mPropertyMailbox.fetch(pts, force, &props)) {
+        return;
+    }
+
+    if ((props.changed & PROPERTY_CHANGED_WINDOW_SIZE) &&
+        memcmp(&props.winSize, &mAppliedProps.winSize, sizeof(RenderWindowSize))) {
+        PluginRect rect;
+        rect.x = props.winSize.x;
+        rect.y = props.winSize.y;
+        rect.w = props.winSize.w;
+        rect.h = props.winSize.h;
+        mPlugin->set(PLUGIN_KEY_WINDOW_SIZE, &rect);
+        mAppliedProps.winSize = props.winSize;
+    }
+    if ((props.changed & PROPERTY_CHANGED_FRAME_SIZE) &&
+        (props.frameWidth != mAppliedProps.frameWidth ||
+        props.frameHeight != mAppliedProps.frameHeight)) {
+        PluginFrameSize frameSize;
+        frameSize.w = props.frameWidth;
+        frameSize.h = props.frameHeight;
+        mPlugin->set(PLUGIN_KEY_FRAME_SIZE, &frameSize);
+        mAppliedProps.frameWidth = props.frameWidth;
+        mAppliedProps.frameHeight = props.frameHeight;
+    }
+    mAppliedProps.version = props.version;
+    TRACE2(mLogCategory,"applied properties version:%d,changed:%x,frame pts:%lld",
+        props.version,props.changed,pts);
+}
+
+void RenderCore::updateQos(int64_t pts, int64_t lateUs, int dropCnt)
+{
+    int64_t nowUs;
+    int64_t intervalNs;
+    bool behind;
+
+    //smoothed over frames,a dropped frame counts 1000,decay
+    //rounds up so rate goes back to 0
+    if (dropCnt > 0) {
+        for (int i = 0; i < dropCnt; i++) {
+            mQos.dropRate += (1000 - mQos.dropRate) / QOS_DROP_RATE_WEIGHT;
+        }
+    } else {
+        mQos.dropRate -= (mQos.dropRate + QOS_DROP_RATE_WEIGHT - 1) / QOS_DROP_RATE_WEIGHT;
+    }
+    mQos.processed += dropCnt > 0? dropCnt : 1;
+    mQos.dropped += dropCnt;
+    mQos.pts = pts;
+    mQos.lateUs = lateUs;
+
+    if (mQosIntervalMs <= 0 || !mCallback) {
+        return;
+    }
+    nowUs = Tls::Times::getSystemTimeUs();
+    if (nowUs - mQosLastSendUs < (int64_t)mQosIntervalMs * 1000) {
+        return;
+    }
+
+    //late more than a frame,next frames are going to be dropped
+    intervalNs = getFrameIntervalNs();
+    if (mQos.dropRate >= QOS_LOWER_RESOLUTION_DROP_RATE) {
+        mQos.action = QOS_ACTION_LOWER_RESOLUTION;
+    } else if (mQos.dropRate >= QOS_SKIP_NON_REF_DROP_RATE ||
+        (intervalNs > 0 && lateUs * 1000 > intervalNs)) {
+        mQos.action = QOS_ACTION_SKIP_NON_REF;
+    } else {
+        mQos.action = QOS_ACTION_NONE;
+    }
+    //send while falling behind and once more when recovered
+    behind = mQos.action != QOS_ACTION_NONE || mQos.dropRate > 0;
+    if (!behind && !mQosBehind) {
+        return;
+    }
+    mQos.queueDepth = mQueue->getCnt();
+    mQosBehind = behind;
+    mQosLastSendUs = nowUs;
+    DEBUG(mLogCategory,"qos pts:%lld,late:%lld us,drop rate:%d,queue:%d,processed:%d,dropped:%d,action:%d",
+        mQos.pts,mQos.lateUs,mQos.dropRate,mQos.queueDepth,mQos.processed,mQos.dropped,mQos.action);
+    mCallback->doMsgSend(mUserData, MSG_QOS, &mQos);
+}
+
+void RenderCore::updateJitterTarget(int64_t ptsNs)
+{
+    int64_t nowUs = Tls::Times::getSystemTimeUs();
+    int64_t jitterUs;
+    int64_t coverNs;
+    float rate;
+    int target;
+
+    mConfigMutex.lock();
+    rate = mPlaybackRate;
+    mConfigMutex.unlock();
+
+    mJitterEstimator.addArrival(ptsNs, nowUs, rate);
+    jitterUs = mJitterEstimator.getJitterUs();
+    if (mFrameIntervalNs <= 0 || rate <= 0.0f) {
+        return;
+    }
+
+    //queued frames must cover jitter,plus the one being displayed
+    coverNs = (int64_t)(jitterUs * 1000 * rate);
+    target = (int)((coverNs + mFrameIntervalNs - 1) / mFrameIntervalNs) + 1;
+    if (target > JITTER_MAX_DEPTH) {
+        target = JITTER_MAX_DEPTH;
+    }
+    if (mQueueMaxDepth > 0 && target > mQueueMaxDepth) {
+        target = mQueueMaxDepth;
+    }
+
+    //grow at once to stop underrun,shrink slowly so a
+    //quiet period does not drop depth needed by next burst
+    if (target > mJitterTargetDepth) {
+        DEBUG(mLogCategory,"jitter buffer depth %d -> %d,jitter:%lld us",mJitterTargetDepth,target,jitterUs);
+        mJitterTargetDepth = target;
+        mJitterShrinkTimeUs = nowUs;
+    } else if (target < mJitterTargetDepth &&
+        nowUs - mJitterShrinkTimeUs > JITTER_SHRINK_INTERVAL_US) {
+        DEBUG(mLogCategory,"jitter buffer depth %d -> %d,jitter:%lld us",mJitterTargetDepth,mJitterTargetDepth-1,jitterUs);
+        mJitterTargetDepth--;
+        mJitterShrinkTimeUs = nowUs;
+    }
+}
+
+bool RenderCore::jitterPrebuffer(int64_t nowUs)
+{
+    //running clock is steered by slew,only fill queue before anchor
+    if (mFreeRunAnchorPts >= 0 || mQueue->getCnt() >= mJitterTargetDepth) {
+        mJitterPrebufferStartUs = 0;
+        return false;
+    }
+    if (mJitterPrebufferStartUs == 0) {
+        mJitterPrebufferStartUs = nowUs;
+        TRACE2(mLogCategory,"jitter buffer prebuffer,queue:%d,target:%d",mQueue->getCnt(),mJitterTargetDepth);
+    }
+    //input may never reach target,e.g. end of stream
+    return nowUs - mJitterPrebufferStartUs < JITTER_PREBUFFER_MAX_US;
+}
+
+float RenderCore::jitterSlew()
+{
+    int depth = mQueue->getCnt();
+    int target = mJitterTargetDepth;
+    float slew = 0.0f;
+
+    //one frame of hysteresis,so slew does not toggle on every frame
+    if (depth > target + 1) {
+        slew = JITTER_SLEW_RATE;
+    } else if (depth < target) {
+        slew = -JITTER_SLEW_RATE;
+    }
+    if (slew != mFreeRunSlew) {
+        TRACE2(mLogCategory,"jitter buffer slew %f,queue:%d,target:%d",slew,depth,target);
+    }
+    return slew;
+}
+
+int64_t RenderCore::getFrameIntervalNs()
+{
+    Tls::Mutex::Autolock _l(mInputMutex);
+    return mFrameIntervalNs;
+}
+
+int64_t RenderCore::nanosecToPTS90K(int64_t nanosec)
+{
+    return (nanosec / 100) * 9;
+}
+
+void RenderCore::setMediasyncPropertys()
+{
+    //set mediasync source type
+    if (mMediaSync && mMediaSyncBind && mMediasyncSourceType.changed) {
+        INFO(mLogCategory,"do set mediasync source type: %d",mMediasyncSourceType);
+        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_SOURCETYPE, (void* )&mMediasyncSourceType);
+    }
+
+    //set mediasync has audio
+    if (mMediaSync && mMediaSyncBind && mMediasyncHasAudio.changed) {
+        INFO(mLogCategory,"do set mediasync has audio: %d",mMediasyncHasAudio.value);
+         mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_HASAUDIO, (void* )&mMediasyncHasAudio.value);
+    }
+
+    //set mediasync video latency
+    if (mMediaSync && mMediaSyncBind && mMediasyncVideoLatency.changed) {
+        INFO(mLogCategory,"do set mediasync video latency: %d",mMediasyncVideoLatency);
+        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_VIDEOLATENCY, (void* )&mMediasyncVideoLatency.value);
+    }
+
+    //set mediasync start threshold
+    if (mMediaSync && mMediaSyncBind && mMediasyncStartThreshold.changed) {
+        INFO(mLogCategory,"do set mediasync start threshold: %d",mMediasyncStartThreshold.value);
+        mediasync_setParameter(mMediaSync, MEDIASYNC_KEY_STARTTHRESHOLD, (void* )&mMediasyncStartThreshold.value);
+    }
+}
+
+void RenderCore::waitTimeoutUs(int64_t timeoutMs)
+{
+    //shared scheduler thread must not block,next pass is delayed instead
+    if (mScheduled) {
+        requestWakeUs(Tls::Times::getSystemTimeUs() + timeoutMs);
+        return;
+    }
+    Tls::Mutex::Autolock _l(mLimitMutex);
+    mLimitCondition.waitRelativeUs(mLimitMutex, timeoutMs);
+}
+
+bool RenderCore::beginDisplay()
+{
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    //flush posts flushing under render mutex,queue head may be of old
+    //generation until display thread releases stale frames
+    if (getPacingState() == PACING_STATE_FLUSHING || mStaleFrameCnt > 0 || mPluginFlushPending) {
+        return false;
+    }
+    mDisplayBusy = true;
+    return true;
+}
+
+void RenderCore::endDisplay()
+{
+    Tls::Mutex::Autolock _l(mRenderMutex);
+    mDisplayBusy = false;
+    mDisplayIdleCondition.broadcast();
+}
+
+void RenderCore::waitDisplayIdleLocked()
+{
+    while (mDisplayBusy) {
+        mDisplayIdleCondition.wait(mRenderMutex);
+    }
+}
+
+void RenderCore::waitUntilUs(int64_t deadlineUs)
+{
+    if (mScheduled) {
+        requestWakeUs(deadlineUs);
+        return;
+    }
+    Tls::Mutex::Autolock _l(mLimitMutex);
+    //rate change,pause and flush wake up display thread
+    int kick = mPacingKick;
+    while (mPacing.isDisplaying() && mPacingKick == kick) {
+        int64_t nowUs = Tls::Times::getSystemTimeUs();
+        if (nowUs >= deadlineUs) {
+            break;
+        }
+        mLimitCondition.waitRelativeUs(mLimitMutex, deadlineUs - nowUs);
+    }
+}
+
+void RenderCore::wakeupDisplayThread()
+{
+    if (mScheduled) {
+        mNextWakeUs = 0;
+        DisplayScheduler::getInstance()->wakeup();
+        return;
+    }
+    Tls::Mutex::Autolock _l(mLimitMutex);
+    mPacingKick++;
+    mLimitCondition.broadcast();
+}
+
+int RenderCore::postPacingEvent(int event)
+{
+    int state, newState;
+
+    mLimitMutex.lock();
+    state = mPacing.getState();
+    newState = mPacing.postEvent(event);
+    mLimitMutex.unlock();
+    if (newState != state) {
+        DEBUG(mLogCategory,"pacing %s -> %s on %s",PacingStateMachine::stateName(state),
+            PacingStateMachine::stateName(newState),PacingStateMachine::eventName(event));
+    }
+    wakeupDisplayThread();
+    return newState;
+}
+
+int RenderCore::getPacingState()
+{
+    Tls::Mutex::Autolock _l(mLimitMutex);
+    return mPacing.getState();
+}
+
+void RenderCore::checkQueueState()
+{
+    int state, newState, cnt;
+
+    mLimitMutex.lock();
+    cnt = mQueue->getCnt();
+    //display thread itself changes state,no wakeup needed
+    state = mPacing.getState();
+    newState = mPacing.postQueueState(cnt, mReorderDepth > 0);
+    mLimitMutex.unlock();
+    if (newState != state) {
+        TRACE2(mLogCategory,"pacing %s -> %s,queued frames:%d",PacingStateMachine::stateName(state),
+            PacingStateMachine::stateName(newState),cnt);
+    }
+}
+
+void RenderCore::waitPacingEvent(int kick, int64_t deadlineUs)
+{
+    int64_t nowUs = Tls::Times::getSystemTimeUs();
+
+    if (deadlineUs < 0) {
+        deadlineUs = nowUs + PACING_IDLE_WAIT_US;
+    }
+    if (mScheduled) {
+        requestWakeUs(deadlineUs);
+        return;
+    }
+    Tls::Mutex::Autolock _l(mLimitMutex);
+    while (mPacingKick == kick && nowUs < deadlineUs) {
+        mLimitCondition.waitRelativeUs(mLimitMutex, deadlineUs - nowUs);
+        nowUs = Tls::Times::getSystemTimeUs();
+    }
+}
+
+void RenderCore::requestWakeUs(int64_t wakeUs)
+{
+    int64_t cur = mNextWakeUs;
+    //earliest request wins,wakeup from other thread sets 0
+    while (wakeUs < cur && !mNextWakeUs.compare_exchange_weak(cur, wakeUs)) {
+    }
+}
+
+void RenderCore::startDisplay()
+{
+    if (mSharedScheduler) {
+        mNextWakeUs = 0;
+        mScheduled = true;
+        DisplayScheduler::getInstance()->addCore(this);
+    } else {
+        run("displaythread");
+    }
+}
+
+void RenderCore::stopDisplay()
+{
+    if (mScheduled) {
+        DisplayScheduler::getInstance()->removeCore(this);
+        mScheduled = false;
+    } else if (isRunning()) {
+        requestExitAndWait();
+    }
+}
+
+bool RenderCore::isDisplayRunning()
+{
+    return mScheduled || isRunning();
+}
+
+int64_t RenderCore::runScheduledPass(bool first)
+{
+    int64_t noWait = INT64_MAX;
+
+    if (first) {
+        readyToRun();
+    }
+    mNextWakeUs = INT64_MAX;
+    threadLoop();
+    //pass did not wait,run again at once
+    mNextWakeUs.compare_exchange_strong(noWait, 0);
+    return mNextWakeUs;
+}
+
+void RenderCore::setCommitBatch(bool batch)
+{
+    int value = batch? 1: 0;
+
+    if (mPlugin) {
+        mPlugin->set(PLUGIN_KEY_COMMIT_BATCH, (void *)&value);
+    }
+}
+
+void RenderCore::setPlaybackRateLocal(float rate)
+{
+    if (rate <= 0.0f) {
+        return;
+    }
+    mConfigMutex.lock();
+    if (rate == mPlaybackRate) {
+        mConfigMutex.unlock();
+        return;
+    }
+    DEBUG(mLogCategory,"playback rate %f -> %f",mPlaybackRate,rate);
+    //free run clock starts a new segment from change point,
+    //queued frames are retimed and kept
+    mPlaybackRate = rate;
+    mConfigMutex.unlock();
+    //display thread may wait a frame due time of old rate
+    wakeupDisplayThread();
+}
+
+void RenderCore::retimeFreeRun(float rate, int64_t nowUs)
+{
+    int64_t elapsedUs = nowUs - mFreeRunAnchorTimeUs;
+
+    //new segment begins on vsync grid of old one,so grid phase is kept
+    if (mFreeRunRefreshRate > 0) {
+        int64_t vsyncUs = 1000000000LL / mFreeRunRefreshRate;
+        elapsedUs = elapsedUs / vsyncUs * vsyncUs;
+    }
+    if (elapsedUs < 0) {
+        elapsedUs = 0;
+    }
+    mFreeRunAnchorPts += (int64_t)(elapsedUs * 1000 * mFreeRunAnchorRate);
+    mFreeRunAnchorTimeUs += elapsedUs;
+    TRACE2(mLogCategory,"free run segment pts:%lld,time:%lld us,rate %f -> %f",
+        mFreeRunAnchorPts,mFreeRunAnchorTimeUs,mFreeRunAnchorRate,rate);
+    mFreeRunAnchorRate = rate;
+}
+
+void RenderCore::requestFreeRunReanchor()
+{
+    Tls::Mutex::Autolock _l(mConfigMutex);
+    mFreeRunReanchor = true;
+}
+
+int64_t RenderCore::freeRunDisplayTimeUs(int64_t ptsNs, int64_t nowUs)
+{
+    int64_t displayTimeUs;
+    float rate;
+
+    //no valid pts,pace frames with detected frame interval
+    if (ptsNs < 0) {
+        if (mLastDisplaySystemtime <= 0) {
+            return nowUs;
+        }
+        return mLastDisplaySystemtime + getFrameIntervalNs()/1000;
+    }
+
+    rate = mFreeRunCurRate * (1.0f + mFreeRunSlew);
+    if (mFreeRunAnchorPts < 0) {
+        mFreeRunAnchorPts = ptsNs;
+        mFreeRunAnchorTimeUs = nowUs;
+        mFreeRunAnchorRate = rate;
+        DEBUG(mLogCategory,"free run anchor pts:%lld,time:%lld us,rate:%f",ptsNs,nowUs,rate);
+        return nowUs;
+    }
+
+    //rate or jitter buffer slew changed,map pts with new rate from now on
+    if (rate != mFreeRunAnchorRate) {
+        retimeFreeRun(rate, nowUs);
+    }
+
+    displayTimeUs = mFreeRunAnchorTimeUs + (int64_t)((ptsNs - mFreeRunAnchorPts)/1000/mFreeRunAnchorRate);
+    //pts discontinuity,anchor again with this frame
+    if (displayTimeUs - nowUs > FREE_RUN_REANCHOR_THRESHOLD_US ||
+        nowUs - displayTimeUs > FREE_RUN_REANCHOR_THRESHOLD_US) {
+        WARNING(mLogCategory,"free run pts discontinuity,pts:%lld,anchor pts:%lld,diff:%lld us",
+            ptsNs,mFreeRunAnchorPts,displayTimeUs - nowUs);
+        mFreeRunAnchorPts = ptsNs;
+        mFreeRunAnchorTimeUs = nowUs;
+        mFreeRunAnchorRate = rate;
+        return nowUs;
+    }
+
+    //put frame on vsync grid from anchor,so frames get pulldown
+    //pattern of content on display,e.g. 3:2 of 24fps on 60Hz,
+    //rather than compositor rounds jittered times
+    if (mFreeRunRefreshRate > 0) {
+        int64_t vsyncUs = 1000000000LL / mFreeRunRefreshRate;
+        displayTimeUs = mFreeRunAnchorTimeUs + (displayTimeUs - mFreeRunAnchorTimeUs) / vsyncUs * vsyncUs;
+    }
+    return displayTimeUs;
+}
+
+void RenderCore::mediaSyncTunnelmodeDisplay()
+{
+    mediasync_result ret;
+    int64_t nowSystemtimeUs; //us unit
+    int64_t nowMediasyncTimeUs; //us unit
+    int64_t realtimeUs; //us unit
+    int64_t delaytimeUs; //us unit
+    int displayLatencyUs; //snapshot,estimate is updated on plugin thread
+    int64_t nowPts;
+    RenderBuffer *buf;
+    int qRet;
+    int64_t needWaitTimeUs = 0;
+
+    if (!beginDisplay()) {
+        return;
+    }
+    if (!mMediaSync || !mMediaSyncBind) {
+        WARNING(mLogCategory,"No create mediasync or no init mediasync");
+        goto Err_tag;
+    }
+
+    qRet = mQueue->peek((void **) &buf, 0);
+    if (qRet != Q_OK) {
+        WARNING(mLogCategory, "pop item from queue failed");
+        goto Err_tag;
+    }
+
+    nowPts = buf->pts;
+
+    //update mediasync pts when vmaster
+    if (mSyncmode == MEDIA_SYNC_VMASTER) {
+        if ( mMediaSyncAnchor == false) {
+            mMediaSyncAnchor = true;
+            INFO(mLogCategory,"anchor pts:%lld",nowPts);
+            if (nowPts == 0) { //if pts is 0, mediasync do not update realtime,so workround
+                MediaSync_updateAnchor(mMediaSync, 2*1000, 0, 0);
+            } else {
+                MediaSync_updateAnchor(mMediaSync, nowPts/1000, 0, 0);
+            }
+        }
+    }
+
+    //get video frame display time
+    if (nowPts == 0) {
+        ret = MediaSync_getRealTimeFor(mMediaSync, 2*1000/*us*/, &realtimeUs);
+    } else {
+        ret = MediaSync_getRealTimeFor(mMediaSync, nowPts/1000/*us*/, &realtimeUs);
+    }
+    if (ret != AM_MEDIASYNC_OK) {
+        WARNING(mLogCategory,"get mediasync realtime fail");
+        realtimeUs = -1;
+    }
+
+    //get systemtime
+    nowSystemtimeUs = Tls::Times::getSystemTimeUs();
+    //get mediasync systemtime
+    ret = MediaSync_getRealTimeForNextVsync(mMediaSync, &nowMediasyncTimeUs);
+    if (ret != AM_MEDIASYNC_OK) {
+        WARNING(mLogCategory,"get mediasync time fail");
+    }
+
+    displayLatencyUs = mDisplayLatencyUs;
+    delaytimeUs = realtimeUs - nowMediasyncTimeUs - displayLatencyUs;
+
+    if (delaytimeUs <= 0) {
+        if (realtimeUs < 0) {
+            if (mSyncmode == MEDIA_SYNC_AMASTER) {
+                if (mWaitAnchorTimeUs < WAIT_AUDIO_TIME_US) {
+                    mWaitAnchorTimeUs += 2000;
+                    WARNING(mLogCategory,"waited audio anchor mediasync %d us",mWaitAnchorTimeUs);
+                    needWaitTimeUs = 2000;
+                    goto Block_tag;
+                } else {
+                    WARNING(mLogCategory,"wait audio anchor mediasync timeout, use vmaster");
+                    MediaSync_setSyncMode(mMediaSync, MEDIA_SYNC_VMASTER);
+                    mSyncmode = MEDIA_SYNC_VMASTER;
+                    mWaitAnchorTimeUs = 0;
+                    goto Err_tag;
+                }
+            }
+            if (mSyncmode == MEDIA_SYNC_VMASTER) {
+                mWaitAnchorTimeUs += 2000;
+                WARNING(mLogCategory,"video had anchored mediasync,wait realtm %d us",mWaitAnchorTimeUs);
+                needWaitTimeUs = 2000;
+                goto Block_tag;
+            }
+
+            /*use pts diff to send frame displaying,when get realtime fail,
+            the first frame send imediately,but other frames will send
             interval pts diff time
             */
             if (mLastDisplayPTS >= 0) {
                 int64_t ptsdifUs = (nowPts - mLastDisplayPTS)/1000;
-                delaytimeUs = (ptsdifUs - LATENCY_TO_HDMI_TIME_US) > 0 ? (ptsdifUs - LATENCY_TO_HDMI_TIME_US) : ptsdifUs;
+                delaytimeUs = (ptsdifUs - displayLatencyUs) > 0 ? (ptsdifUs - displayLatencyUs) : ptsdifUs;
                 if (delaytimeUs > 0 && mIsLimitDisplayFrame) {
                     needWaitTimeUs = delaytimeUs;
                     goto Block_tag;
                 } else {
                     delaytimeUs = 0;
                 }
-                //add a LATENCY_TO_HDMI_TIME_US time that weston will check display success
-                realtimeUs = mLastDisplayRealtime + ptsdifUs + LATENCY_TO_HDMI_TIME_US;
+                //add the display latency time that weston will check display success
+                realtimeUs = mLastDisplayRealtime + ptsdifUs + displayLatencyUs;
             } else if (mLastDisplayPTS == -1) { //first frame,displayed immediately
-                realtimeUs = nowMediasyncTimeUs + LATENCY_TO_HDMI_TIME_US;
+                realtimeUs = nowMediasyncTimeUs + displayLatencyUs;
                 delaytimeUs = 0;
             }
         }
@@ -1050,29 +2250,34 @@ void RenderCore::mediaSyncTunnelmodeDisplay()
         ERROR(mLogCategory,"error, now pts:%lld, but queue first item pts:%lld",nowPts,buf->pts);
         goto Err_tag;
     }
-    mQueue->pop((void **)&buf);
 
     //TRACE3(mLogCategory,"PTSNs:%lld,lastPTSNs:%lld,realtmUs:%lld,mtmUs:%lld,stmUs:%lld",buf->pts,mLastDisplayPTS,realtimeUs,nowMediasyncTimeUs,nowSystemtimeUs);
 
     //display video frame
     TRACE1(mLogCategory,"+++++display frame:%p, ptsNs:%lld(%lld ms),realtmUs:%lld,realtmDiffMs:%lld,realToSysDiffMs:%lld",
             buf,buf->pts,buf->pts/1000000,realtimeUs,(realtimeUs-mLastDisplayRealtime)/1000,(realtimeUs-mLastDisplaySystemtime)/1000);
-    if (mPlugin) {
-        mPlugin->displayFrame(buf, realtimeUs);
+    applyProperties(buf->pts, false);
+    if (mPlugin && mPlugin->displayFrame(buf, realtimeUs) == ERROR_WOULD_BLOCK) {
+        //compositor busy,keep frame in queue and retry later
+        TRACE1(mLogCategory,"plugin busy,hold frame pts:%lld",buf->pts);
+        needWaitTimeUs = PLUGIN_BUSY_HOLD_TIME_US;
+        goto Block_tag;
     }
+    mQueue->pop((void **)&buf);
     mLastDisplayPTS = buf->pts;
     mLastDisplayRealtime = realtimeUs;
     mLastDisplaySystemtime = nowSystemtimeUs;
-    mRenderMutex.unlock();
+    endDisplay();
+    updateQos(nowPts, -delaytimeUs, 0);
     return;
 Block_tag:
-    mRenderMutex.unlock();
+    endDisplay();
     if (needWaitTimeUs > 0) {
         waitTimeoutUs(needWaitTimeUs);
     }
     return;
 Err_tag:
-    mRenderMutex.unlock();
+    endDisplay();
     return;
 }
 
@@ -1089,7 +2294,9 @@ void RenderCore::mediaSyncNoTunnelmodeDisplay()
     int64_t needWaitTimeUs = 0;
     int qRet;
 
-    mRenderMutex.lock();
+    if (!beginDisplay()) {
+        return;
+    }
     if (!mMediaSync || !mMediaSyncBind) {
         WARNING(mLogCategory,"No create mediasync or no init mediasync");
         goto Err_tag;
@@ -1119,7 +2326,6 @@ void RenderCore::mediaSyncNoTunnelmodeDisplay()
             ERROR(mLogCategory,"error, now pts:%lld, but queue first item pts:%lld",nowPts,buf->pts);
             goto Err_tag;
         }
-        mQueue->pop((void **)&buf);
 
         realtimeUs = vsyncPolicy.param1;
         //get mediasync systemtime
@@ -1134,15 +2340,24 @@ void RenderCore::mediaSyncNoTunnelmodeDisplay()
         //display video frame
         TRACE1(mLogCategory,"+++++display frame:%p, ptsNs:%lld(%lld ms),realtmUs:%lld,realtmDiffMs:%lld,toLastDisplayDiffMs:%lld",
             buf,buf->pts,buf->pts/1000000,realtimeUs,(realtimeUs-mLastDisplayRealtime)/1000,(realtimeUs-mLastDisplaySystemtime)/1000);
-        if (mPlugin) {
-            mPlugin->displayFrame(buf, realtimeUs);
+        applyProperties(buf->pts, false);
+        if (mPlugin && mPlugin->displayFrame(buf, realtimeUs) == ERROR_WOULD_BLOCK) {
+            //compositor busy,keep frame in queue,mediasync decides
+            //to display or drop it on next loop
+            TRACE1(mLogCategory,"plugin busy,hold frame pts:%lld",nowPts);
+            needWaitTimeUs = PLUGIN_BUSY_HOLD_TIME_US;
+            endDisplay();
+            waitTimeoutUs(needWaitTimeUs);
+            return;
         }
+        mQueue->pop((void **)&buf);
 
         mLastDisplayPTS = nowPts;
         mLastDisplayRealtime = realtimeUs;
         mLastDisplaySystemtime = nowSystemtimeUs;
         mWaitAnchorTimeUs = 0;
         needWaitTimeUs = 0;
+        updateQos(nowPts, nowMediasyncTimeUs - realtimeUs, 0);
     } else if (vsyncPolicy.videopolicy == MEDIASYNC_VIDEO_HOLD) {
         //vsyncPolicy.param2 is hold time us
         needWaitTimeUs = vsyncPolicy.param2;
@@ -1166,17 +2381,193 @@ void RenderCore::mediaSyncNoTunnelmodeDisplay()
         }
         RenderCore::pluginBufferDropedCallback(this, (void *)buf);
         RenderCore::pluginBufferReleaseCallback(this, (void *)buf);
+        //frames behind this one are likely late too,drop them in this pass
+        int64_t lateUs = 0;
+        int dropCnt = dropLateFrames(nowPts, &lateUs);
+        updateQos(nowPts, lateUs, dropCnt + 1);
     }
-    mRenderMutex.unlock();
+    endDisplay();
     if (needWaitTimeUs > 0) {
         waitTimeoutUs(needWaitTimeUs);
     }
     return;
 Err_tag:
-    mRenderMutex.unlock();
+    endDisplay();
     return;
 }
 
+int RenderCore::dropLateFrames(int64_t dropedPts, int64_t *lateUs)
+{
+    RenderBuffer *dropFrames[MAX_CATCHUP_DROP_FRAMES];
+    RenderBuffer *buf = NULL;
+    RenderBuffer *nextBuf = NULL;
+    int64_t dropedRealtimeUs = 0;
+    int64_t nowSystemtimeUs;
+    int64_t nextRealtimeUs;
+    float rate = 1.0f;
+    int dropCnt = 0;
+    mediasync_result ret;
+
+    //map the droped frame pts to system time once,later frames are
+    //extrapolated from it with playback rate instead of asking mediasync
+    //for every frame
+    ret = MediaSync_getRealTimeFor(mMediaSync, dropedPts/1000, &dropedRealtimeUs);
+    if (ret != AM_MEDIASYNC_OK || dropedRealtimeUs <= 0) {
+        return 0;
+    }
+    ret = MediaSync_getPlaybackRate(mMediaSync, &rate);
+    if (ret != AM_MEDIASYNC_OK || rate <= 0.0f) {
+        rate = 1.0f;
+    }
+    nowSystemtimeUs = Tls::Times::getSystemTimeUs();
+    *lateUs = nowSystemtimeUs - dropedRealtimeUs;
+
+    //drop queue head while the frame after it is already due,so the
+    //head left is the newest frame that is still on time
+    while (dropCnt < MAX_CATCHUP_DROP_FRAMES) {
+        if (mQueue->peek((void **)&buf, 0) != Q_OK ||
+            mQueue->peek((void **)&nextBuf, 1) != Q_OK) {
+            break;
+        }
+        nextRealtimeUs = dropedRealtimeUs + (int64_t)((nextBuf->pts - dropedPts)/1000/rate);
+        if (nextRealtimeUs > nowSystemtimeUs) {
+            break;
+        }
+        mQueue->pop((void **)&buf);
+        dropFrames[dropCnt++] = buf;
+    }
+
+    if (dropCnt > 0) {
+        WARNING(mLogCategory,"catch up,drop %d late frames,pts %lld ~ %lld",
+            dropCnt,dropFrames[0]->pts,dropFrames[dropCnt-1]->pts);
+    }
+    for (int i = 0; i < dropCnt; i++) {
+        RenderCore::pluginBufferDropedCallback(this, (void *)dropFrames[i]);
+        RenderCore::pluginBufferReleaseCallback(this, (void *)dropFrames[i]);
+    }
+    return dropCnt;
+}
+
+void RenderCore::lowLatencyDisplay(int kick)
+{
+    RenderBuffer *buf = NULL;
+    RenderBuffer *dropBuf = NULL;
+    int64_t displayTimeUs;
+    int ret;
+
+    mRenderMutex.lock();
+    if (getPacingState() == PACING_STATE_FLUSHING || !mLatestFrame) {
+        mRenderMutex.unlock();
+        //woken up by frame queued event
+        waitPacingEvent(kick, -1);
+        return;
+    }
+    buf = mLatestFrame;
+    mLatestFrame = NULL;
+    mDisplayBusy = true;
+    mRenderMutex.unlock();
+
+    displayTimeUs = Tls::Times::getSystemTimeUs();
+    TRACE1(mLogCategory,"+++++display frame:%p, pts(ns):%lld, displaytime:%lld",buf,buf->pts,displayTimeUs);
+    applyProperties(buf->pts, false);
+    ret = mPlugin->displayFrame(buf, displayTimeUs);
+
+    mRenderMutex.lock();
+    if (ret == ERROR_WOULD_BLOCK) {
+        //last commit not released yet,keep frame unless a newer one came
+        if (mLatestFrame) {
+            dropBuf = buf;
+        } else {
+            mLatestFrame = buf;
+        }
+    } else {
+        mLastDisplayPTS = buf->pts;
+        mLastDisplaySystemtime = displayTimeUs;
+    }
+    mDisplayBusy = false;
+    mDisplayIdleCondition.broadcast();
+    mRenderMutex.unlock();
+
+    if (dropBuf) {
+        RenderCore::pluginBufferDropedCallback(this, (void *)dropBuf);
+        RenderCore::pluginBufferReleaseCallback(this, (void *)dropBuf);
+    }
+    if (ret == ERROR_WOULD_BLOCK) {
+        //woken up when compositor releases a frame
+        waitPacingEvent(kick, Tls::Times::getSystemTimeUs() + PLUGIN_BUSY_HOLD_TIME_US);
+    }
+}
+
+void RenderCore::prerollFirstFrame()
+{
+    RenderBuffer *buf = NULL;
+    int64_t displayTimeUs;
+
+    if (!beginDisplay()) {
+        return;
+    }
+    if (mQueue->peek((void **)&buf, 0) != Q_OK) {
+        endDisplay();
+        return;
+    }
+
+    displayTimeUs = Tls::Times::getSystemTimeUs();
+    INFO(mLogCategory,"preroll first frame:%p,pts:%lld",buf,buf->pts);
+    applyProperties(buf->pts, false);
+    if (mPlugin->displayFrame(buf, displayTimeUs) == ERROR_WOULD_BLOCK) {
+        //compositor busy,keep frame in queue and retry later
+        endDisplay();
+        waitTimeoutUs(PLUGIN_BUSY_HOLD_TIME_US);
+        return;
+    }
+    mQueue->pop((void **)&buf);
+    //a/v sync begins from next frame
+    mLastDisplayPTS = buf->pts;
+    mLastDisplayRealtime = displayTimeUs;
+    mLastDisplaySystemtime = displayTimeUs;
+    endDisplay();
+
+    if (mCallback) {
+        mCallback->doMsgSend(mUserData, MSG_FIRST_FRAME_PREROLLED, buf);
+    }
+}
+
+void RenderCore::releaseStaleFrames()
+{
+    RenderBuffer *buf = NULL;
+    bool pluginFlush;
+    int staleCnt = 0;
+
+    mRenderMutex.lock();
+    pluginFlush = mPluginFlushPending;
+    mPluginFlushPending = false;
+    //old generation frames are always ahead of new ones in queue
+    while (mStaleFrameCnt > 0) {
+        if (mQueue->pop((void **)&buf) != Q_OK) {
+            mStaleFrameCnt = 0;
+            break;
+        }
+        mStaleFrameCnt--;
+        staleCnt++;
+        queueFlushCallback(this, buf);
+    }
+    if (staleCnt > 0) {
+        //producer may wait queue space
+        mDisplayIdleCondition.broadcast();
+    }
+    mRenderMutex.unlock();
+
+    if (staleCnt > 0) {
+        DEBUG(mLogCategory,"released %d frames of old generation",staleCnt);
+    }
+    //frames in plugin are released when compositor returns them
+    if (pluginFlush && mPlugin) {
+        mPlugin->flush();
+        //target frame may be of old generation and never come
+        applyProperties(-1, true);
+    }
+}
+
 void RenderCore::readyToRun()
 {
     DEBUG(mLogCategory,"Displaythread,readyToRun");
@@ -1250,31 +2641,55 @@ bool RenderCore::threadLoop()
     int64_t beforeTime = 0;
     int64_t nowTime = 0;
     int64_t ptsInterval = 0;
-
-    if (mPaused || mFlushing || mQueue->getCnt() <= 0) {
-        usleep(4*1000);
+    int64_t lastDisplayPts = mLastDisplayPTS;
+    int state;
+    int kick;
+
+    //wakeups after this are not lost by waits of this pass
+    mLimitMutex.lock();
+    kick = mPacingKick;
+    mLimitMutex.unlock();
+
+    releaseStaleFrames();
+
+    //changes without target frame are applied at once,even no frame
+    applyProperties(-1, false);
+
+    //low latency mode waits its latest frame itself
+    if (!mLowLatencyMode && !mStandby) {
+        checkQueueState();
+    }
+    state = getPacingState();
+    if (state == PACING_STATE_DRAINING) {
+        int64_t drainUs = drainReorderWindow();
+        sendDecimationChanged();
+        //drained frames are queued,wait returns at once
+        waitPacingEvent(kick, drainUs > 0? drainUs : -1);
         return true;
     }
-
-    if (mWinSizeChanged) {
-        PluginRect rect;
-        rect.x = mWinSize.x;
-        rect.y = mWinSize.y;
-        rect.h = mWinSize.w;
-        rect.w = mWinSize.h;
-        mPlugin->set(PLUGIN_KEY_WINDOW_SIZE, &rect);
-        mWinSizeChanged = false;
+    if (mStandby || (state != PACING_STATE_PREROLL && state != PACING_STATE_PLAYING)) {
+        //woken up by new frame,resume,flush end and promote
+        waitPacingEvent(kick, -1);
+        return true;
     }
 
-    if (mFrameChanged) {
-        PluginFrameSize frameSize;
-        frameSize.w = mFrameWidth;
-        frameSize.h = mFrameHeight;
-        mPlugin->set(PLUGIN_KEY_FRAME_SIZE, &frameSize);
-        mFrameChanged = false;
+    //take a snapshot of changed config,apply it without config lock held
+    float freeRunRate;
+    mConfigMutex.lock();
+    if (mFreeRunReanchor) {
+        mFreeRunAnchorPts = -1;
+        mFreeRunReanchor = false;
     }
+    freeRunRate = mPlaybackRate;
+    mFreeRunRefreshRate = mCadence.refreshRate;
+    mConfigMutex.unlock();
+    mFreeRunCurRate = freeRunRate;
 
-    if (mMediaSync && mMediaSyncBind) {
+    if (mLowLatencyMode) {
+        lowLatencyDisplay(kick);
+    } else if (mFastFirstFrame && state == PACING_STATE_PREROLL) {
+        prerollFirstFrame();
+    } else if (mMediaSync && mMediaSyncBind) {
         if (mMediaSyncTunnelmode.value == 1) {
             mediaSyncTunnelmodeDisplay();
         } else {
@@ -1282,24 +2697,51 @@ bool RenderCore::threadLoop()
         }
     } else {
         RenderBuffer *buf = NULL;
-        mRenderMutex.lock();
-        int ret = mQueue->pop((void **)&buf);
+        int64_t nowTimeUs = Tls::Times::getSystemTimeUs();
+        if (mJitterBufferEnable) {
+            if (jitterPrebuffer(nowTimeUs)) {
+                //woken up by frame queued event,or prebuffer time out
+                waitPacingEvent(kick, mJitterPrebufferStartUs + JITTER_PREBUFFER_MAX_US);
+                return true;
+            }
+            mFreeRunSlew = jitterSlew();
+        } else {
+            mFreeRunSlew = 0.0f;
+        }
+        if (!beginDisplay()) {
+            return true;
+        }
+        int ret = mQueue->peek((void **)&buf, 0);
         if (ret != Q_OK) {
-            WARNING(mLogCategory, "pop item from queue failed");
-            mRenderMutex.unlock();
+            WARNING(mLogCategory, "peek item from queue failed");
+            endDisplay();
             return true;
         }
 
-        int64_t nowTimeUs = Tls::Times::getSystemTimeUs();
-        int64_t displayTimeUs = nowTimeUs;
-        if (buf) {
-            TRACE1(mLogCategory,"+++++display frame:%p, pts(ns):%lld, displaytime:%lld",buf,buf->pts,displayTimeUs);
-            mPlugin->displayFrame(buf, displayTimeUs);
-            mLastDisplayPTS = buf->pts;
+        int64_t displayTimeUs = freeRunDisplayTimeUs(buf->pts, nowTimeUs);
+        if (displayTimeUs > nowTimeUs) {
+            //not due yet,frame stays queue head until deadline
+            endDisplay();
+            waitUntilUs(displayTimeUs);
+            return true;
         }
-        mRenderMutex.unlock();
+        TRACE1(mLogCategory,"+++++display frame:%p, pts(ns):%lld, displaytime:%lld",buf,buf->pts,displayTimeUs);
+        applyProperties(buf->pts, false);
+        if (mPlugin->displayFrame(buf, displayTimeUs) == ERROR_WOULD_BLOCK) {
+            //compositor busy,keep frame in queue and retry later
+            endDisplay();
+            waitTimeoutUs(PLUGIN_BUSY_HOLD_TIME_US);
+            return true;
+        }
+        mLastDisplayPTS = buf->pts;
+        mLastDisplaySystemtime = displayTimeUs;
+        mQueue->pop((void **)&buf);
+        endDisplay();
+        updateQos(mLastDisplayPTS, nowTimeUs - displayTimeUs, 0);
+    }
 
-        waitTimeoutUs(mFPSIntervalMs*1000);
+    if (state == PACING_STATE_PREROLL && mLastDisplayPTS != lastDisplayPts) {
+        postPacingEvent(PACING_EVENT_FRAME_SHOWN);
     }
 
     return true;
@@ -1,13 +1,19 @@
 #ifndef __RENDER_CORE_H__
 #define __RENDER_CORE_H__
 #include <mutex>
+#include <atomic>
 #include <list>
+#include <vector>
 #include <string>
 #include <unordered_map>
 #include "render_lib.h"
 #include "Thread.h"
 #include "render_plugin.h"
 #include "Queue.h"
+#include "frame_rate_estimator.h"
+#include "jitter_estimator.h"
+#include "property_mailbox.h"
+#include "pacing_state.h"
 
 #ifdef  __cplusplus
 extern "C" {
@@ -69,6 +75,13 @@ class RenderCore : public Tls::Thread{
      */
     int getProp(int property, void *prop);
     int flush();
+    /**
+     * @brief leave standby,show video and display cached frames,
+     * first one is shown at once
+     *
+     * @return int 0 sucess,other fail
+     */
+    int promote();
     int pause();
     int resume();
     /**
@@ -170,6 +183,50 @@ class RenderCore : public Tls::Thread{
         return mLogCategory;
     };
 
+    const char *getCompositorName() {
+        return mCompositorName.c_str();
+    };
+
+    int getVideoPip() {
+        return mVideoPip;
+    };
+
+    RenderCallback *getCallback() {
+        return mCallback;
+    };
+
+    void *getUserData() {
+        return mUserData;
+    };
+
+    /**
+     * @brief take plugin out to park it in session cache,display
+     * and window are kept opened and video is hidden,parked plugin
+     * callbacks are ignored
+     *
+     * @return RenderPlugin* NULL if session cache is disabled or
+     * plugin is not connected
+     */
+    RenderPlugin *detachPlugin();
+    /**
+     * @brief use a plugin parked by other session instead of the
+     * one created on init
+     *
+     * @param plugin parked plugin
+     * @param pip pip flag of session that parked it
+     */
+    void attachPlugin(RenderPlugin *plugin, int pip);
+    /**
+     * @brief give back the adopted plugin if its window was
+     * opened with other pip flag,the plugin created on init
+     * is used instead,called before connect
+     *
+     * @param pip pip flag the returned plugin window was opened with
+     * @return RenderPlugin* plugin to park again,NULL if pip matches
+     * or no plugin was adopted
+     */
+    RenderPlugin *returnMismatchedPlugin(int *pip);
+
     /**
      * @brief queue pts that output from demux to mediasync for a/v sync
      * @param ptsNs the pts that output from demux, the unit is nanosecond
@@ -180,6 +237,27 @@ class RenderCore : public Tls::Thread{
     //thread func
     void readyToRun();
     virtual bool threadLoop();
+    /**
+     * @brief run a display pass on shared display scheduler,
+     * waits of the pass become the time of next pass
+     *
+     * @param first first pass of this core
+     * @return int64_t system time us of next pass,0 at once
+     */
+    int64_t runScheduledPass(bool first);
+    /**
+     * @brief begin or end commit batch of shared display scheduler,
+     * frames displayed in batch are published when batch ends
+     *
+     * @param batch true to begin,false to end
+     */
+    void setCommitBatch(bool batch);
+    int64_t getNextWakeUs() {
+        return mNextWakeUs;
+    };
+    int getDisplayRefreshRate() {
+        return mFreeRunRefreshRate;
+    };
 
     /**
      * @brief add the allocated render buffer
@@ -231,8 +309,50 @@ class RenderCore : public Tls::Thread{
      * @param allocInstance check if alloc mediasync instance id
      */
     void mediaSyncInit(bool allocInstance);
+    /**
+     * @brief mark display thread busy with queue head frame,
+     * mediasync and plugin are called without render mutex held
+     * between beginDisplay and endDisplay,flush waits until display
+     * thread leaves this section
+     *
+     * @return bool false if flushing or stale frames not released,
+     * do not touch queue
+     */
+    bool beginDisplay();
+    void endDisplay();
+    /**
+     * @brief wait display thread leaving display section,
+     * must hold mRenderMutex
+     */
+    void waitDisplayIdleLocked();
     void mediaSyncTunnelmodeDisplay();
     void mediaSyncNoTunnelmodeDisplay();
+    /**
+     * @brief display latest input frame at once without a/v sync,
+     * used in low latency mode
+     *
+     * @param kick wakeup count taken at start of pass
+     */
+    void lowLatencyDisplay(int kick);
+    /**
+     * @brief release queued frames of old generation and
+     * flush plugin after flush,called by display thread
+     */
+    void releaseStaleFrames();
+    /**
+     * @brief display first frame after start or flush at once,
+     * without a/v sync
+     */
+    void prerollFirstFrame();
+    /**
+     * @brief drop all queued frames that are already late in one pass,
+     * called after mediasync dropped a frame
+     *
+     * @param dropedPts pts of the frame mediasync dropped,ns unit
+     * @param lateUs lateness of the frame mediasync dropped,0 if unknown
+     * @return int the count of frames dropped
+     */
+    int dropLateFrames(int64_t dropedPts, int64_t *lateUs);
     int64_t nanosecToPTS90K(int64_t nanosec);
     /**
      * @brief block the thread until timeout
@@ -240,15 +360,232 @@ class RenderCore : public Tls::Thread{
      * @param timeoutUs block the special value us time
      */
     void waitTimeoutUs(int64_t timeoutUs);
+    /**
+     * @brief block the thread until the absolute deadline,
+     * return early when pausing or flushing
+     *
+     * @param deadlineUs monotonic system time us
+     */
+    void waitUntilUs(int64_t deadlineUs);
+    void wakeupDisplayThread();
+    /**
+     * @brief post a event to pacing state machine and wake
+     * up display thread
+     *
+     * @param event see _PacingEvent
+     * @return int state after event,see _PacingState
+     */
+    int postPacingEvent(int event);
+    int getPacingState();
+    /**
+     * @brief display thread goes idle or draining if queue is
+     * empty,and leaves idle if queue holds frames,count is
+     * checked under the lock a queued frame posts its event
+     * with,so the frame is not lost,also frames queued while
+     * flushing are shown without waiting a new frame
+     */
+    void checkQueueState();
+    /**
+     * @brief block display thread until woken up after kick
+     * was taken,or until deadline
+     *
+     * @param kick wakeup count taken at start of pass
+     * @param deadlineUs system time us,-1 waits PACING_IDLE_WAIT_US
+     */
+    void waitPacingEvent(int kick, int64_t deadlineUs);
+    /**
+     * @brief start display passes on own thread or on shared
+     * display scheduler
+     */
+    void startDisplay();
+    void stopDisplay();
+    bool isDisplayRunning();
+    /**
+     * @brief run next pass of shared display scheduler not
+     * later than wakeUs
+     *
+     * @param wakeUs system time us
+     */
+    void requestWakeUs(int64_t wakeUs);
+    /**
+     * @brief get free run display time of frame,pts is anchored
+     * to system time on first frame,anchored again on pts
+     * discontinuity,flush and resume,rate change begins a new
+     * segment from the change point
+     *
+     * @param ptsNs frame pts,ns unit
+     * @param nowUs system time now
+     * @return int64_t system time us to display frame
+     */
+    int64_t freeRunDisplayTimeUs(int64_t ptsNs, int64_t nowUs);
+    void setPlaybackRateLocal(float rate);
+    /**
+     * @brief begin a new free run clock segment at now with new
+     * rate,pts mapping is continuous at segment start
+     *
+     * @param rate new rate
+     * @param nowUs system time now
+     */
+    void retimeFreeRun(float rate, int64_t nowUs);
+    void requestFreeRunReanchor();
 
     void setMediasyncPropertys();
+    /**
+     * @brief update frame interval with estimator and user
+     * set fps,must hold mInputMutex
+     */
+    void updateFrameInterval();
+    int64_t getFrameIntervalNs();
+    /**
+     * @brief compare content frame rate with display refresh rate,
+     * request user to switch refresh rate if content judders
+     */
+    void updateCadence();
+    /**
+     * @brief check if frame can be displayed at current playback
+     * rate and display refresh rate,must hold mInputMutex
+     *
+     * @param buffer input frame
+     * @return true if frame should be released without queuing
+     */
+    bool decimateFrame(RenderBuffer *buffer);
+    /**
+     * @brief send MSG_DECIMATION_CHANGED if decimation interval
+     * changed,must not hold mInputMutex
+     */
+    void sendDecimationChanged();
+    /**
+     * @brief take input frame under mInputMutex,see displayFrame
+     */
+    int inputFrame(RenderBuffer *buffer);
+    /**
+     * @brief push input frame to queue after fps detection,
+     * dedup and decimation,must hold mInputMutex
+     *
+     * @param buffer input frame
+     * @param ptsExtrapolated pts is calculated,not from user
+     * @return int 0 sucess,other fail
+     */
+    int queueFrame(RenderBuffer *buffer, bool ptsExtrapolated);
+    /**
+     * @brief put input frame to reorder window,frame of least pts
+     * is emitted to queue when window is over reorder depth,
+     * must hold mInputMutex
+     *
+     * @param buffer input frame
+     */
+    void reorderFrame(RenderBuffer *buffer);
+    void emitReorderedFrameLocked();
+    void drainReorderWindowLocked();
+    /**
+     * @brief emit all frames in reorder window if no input
+     * for REORDER_DRAIN_TIME_US
+     *
+     * @return int64_t system time us the window drains at,
+     * 0 if window is empty or drained
+     */
+    int64_t drainReorderWindow();
+    void flushReorderWindow();
+    /**
+     * @brief block until queue has space,but not longer than
+     * QUEUE_FULL_BLOCK_TIMEOUT_US
+     *
+     * @return true if queue has space,false if timeout
+     */
+    bool waitQueueSpace();
+    /**
+     * @brief drop oldest frames until queue has space,
+     * must hold mInputMutex
+     *
+     * @param maxDepth max frames in queue
+     */
+    void dropOldestFrames(int maxDepth);
+    /**
+     * @brief add input frame arrival to jitter estimate and
+     * update target queue depth,must hold mInputMutex
+     *
+     * @param ptsNs frame pts
+     */
+    void updateJitterTarget(int64_t ptsNs);
+    /**
+     * @brief check if display thread holds frames until queue
+     * reaches jitter buffer target depth,only before free run
+     * clock is anchored
+     *
+     * @param nowUs system time
+     * @return true if holding
+     */
+    bool jitterPrebuffer(int64_t nowUs);
+    /**
+     * @brief get the rate slew that converges queue depth to
+     * jitter buffer target depth
+     *
+     * @return float slew,0 if depth is in range
+     */
+    float jitterSlew();
+    /**
+     * @brief post current window and frame size to display
+     * thread,must hold mConfigMutex
+     *
+     * @param pts frame they are applied with,-1 at once
+     * @param changed changed properties,see _PropertyChanged
+     */
+    void postProperties(int64_t pts, uint32_t changed);
+    /**
+     * @brief apply posted properties to plugin,on display thread
+     *
+     * @param pts pts of frame to be displayed,-1 if no frame
+     * @param force apply even if target frame not reached
+     */
+    void applyProperties(int64_t pts, bool force);
+    /**
+     * @brief update qos with a frame displayed or dropped for
+     * being late and send MSG_QOS if interval passed,on display thread
+     *
+     * @param pts frame pts
+     * @param lateUs lateness of frame,negative is early
+     * @param dropCnt frames dropped for being late,0 if displayed
+     */
+    void updateQos(int64_t pts, int64_t lateUs, int dropCnt);
+    /**
+     * @brief update the estimate of display latency with
+     * the frame presentation info reported by plugin
+     *
+     * @param presented frame presentation info
+     */
+    void updateDisplayLatency(PluginFramePresented *presented);
 
     std::string mCompositorName;
-    mutable Tls::Mutex   mRenderMutex;
-    mutable Tls::Mutex   mLimitMutex;
+    bool mSessionCache; /*keep plugin connected on disconnect for next session*/
+    bool mPluginAdopted; /*plugin is reused from session cache*/
+    int mAdoptedPip; /*pip flag the adopted plugin window was opened with*/
+    RenderPlugin *mSparePlugin; /*plugin created on init,kept until adopted plugin is checked on connect*/
+    int mVideoPip;
+    mutable Tls::Mutex   mRenderMutex; /*guard flushing and display busy state*/
+    Tls::Condition       mDisplayIdleCondition;
+    bool                 mDisplayBusy; /*display thread is displaying queue head*/
+    bool                 mLowLatencyMode; /*only latest frame is displayed,no a/v sync*/
+    RenderBuffer         *mLatestFrame; /*pending frame of low latency mode*/
+    uint32_t             mGeneration; /*increased on every flush*/
+    int                  mStaleFrameCnt; /*old generation frames at queue head*/
+    bool                 mPluginFlushPending; /*plugin flush for last flush not done*/
+    bool                 mFastFirstFrame; /*show first frame without a/v sync*/
+    int                  mQueueMaxDepth; /*max frames in queue,0 is unlimited*/
+    int                  mQueueFullPolicy; /*see RenderQueueFullPolicy*/
+    std::atomic<bool>    mStandby; /*video hidden,frames cached without display,set under mInputMutex*/
+    bool                 mSharedScheduler; /*display on shared display scheduler*/
+    bool                 mScheduled; /*registered on shared display scheduler*/
+    std::atomic<int64_t> mNextWakeUs; /*next pass time on shared display scheduler*/
+    mutable Tls::Mutex   mInputMutex; /*guard input frame state*/
+    mutable Tls::Mutex   mConfigMutex; /*guard window and frame size*/
+    mutable Tls::Mutex   mLimitMutex; /*guard display thread wait and pacing state*/
     Tls::Condition       mLimitCondition;
+    PacingStateMachine   mPacing; /*guarded by mLimitMutex*/
+    int                  mPacingKick; /*count of display thread wakeups,guarded by mLimitMutex*/
     Tls::Queue           *mQueue;
     mutable Tls::Mutex   mBufferMgrMutex;
+    mutable Tls::Mutex   mReleaseMutex; /*guard mReleaseFrameCnt*/
+    Tls::Condition       mReleaseCondition; /*a buffer is returned to app*/
 
     int mRenderlibId;
     int mLogCategory;
@@ -269,40 +606,79 @@ class RenderCore : public Tls::Thread{
     MediasyncConfig mMediasyncStartThreshold;
     MediasyncConfig mMediasyncPlayerInstanceId;
 
-    bool mPaused;
-    bool mFlushing;
     RenderCallback *mCallback;
     void *mUserData;
 
-    //window size
-    bool mWinSizeChanged;
+    //window size,guarded by mConfigMutex
     RenderWindowSize mWinSize;
     RenderVideoFormat mVideoFormat;
 
-    //frame size
-    bool mFrameChanged;
+    //frame size,guarded by mConfigMutex
     int mFrameWidth;
     int mFrameHeight;
 
+    //window and frame size posted to display thread
+    PropertyMailbox mPropertyMailbox;
+    uint32_t mPropertyVersion; /*guarded by mConfigMutex*/
+    PropertySnapshot mAppliedProps; /*applied to plugin,display thread*/
+
     int mWaitAnchorTimeUs; /*wait anchor mediasync time Us*/
     int64_t mLastInputPTS; /*input frame pts, ns unit*/
     int64_t mLastDisplayPTS; /*display frame pts, ns unit*/
     int64_t mLastDisplayRealtime; /*time got from mediasync to display frame*/
     int64_t mLastDisplaySystemtime; /*the local systemtime displaying last renderbuffer*/
+    std::atomic<int> mDisplayLatencyUs; /*estimated latency from submitting frame to display,set on plugin thread*/
+
+    //free run clock,used when no mediasync
+    int64_t mFreeRunAnchorPts; /*ns unit,-1 if not anchored*/
+    int64_t mFreeRunAnchorTimeUs; /*system time of anchor pts*/
+    float mFreeRunCurRate; /*rate used by display thread*/
+    float mPlaybackRate; /*rate set by user,guarded by mConfigMutex*/
+    bool mFreeRunReanchor; /*guarded by mConfigMutex*/
+    int mFreeRunRefreshRate; /*display refresh rate used by display thread,mHz*/
+    float mFreeRunSlew; /*rate slew of jitter buffer,used by display thread*/
+    float mFreeRunAnchorRate; /*rate of current segment,from anchor on*/
+
+    //jitter buffer
+    bool mJitterBufferEnable;
+    JitterEstimator mJitterEstimator; /*guarded by mInputMutex*/
+    int mJitterTargetDepth; /*frames to keep in queue,read by display thread*/
+    int64_t mJitterShrinkTimeUs; /*last time target depth changed,guarded by mInputMutex*/
+    int64_t mJitterPrebufferStartUs; /*0 if not prebuffering,used by display thread*/
+
+    //display cadence,guarded by mConfigMutex
+    RenderDisplayCadence mCadence;
+    int mRequestedRefreshRate; /*last refresh rate requested to user,mHz*/
+
+    //trick play decimation,guarded by mInputMutex
+    int64_t mDecimateIntervalNs; /*min pts interval of displayable frames,0 if no decimation*/
+    std::atomic<bool> mDecimationChanged; /*MSG_DECIMATION_CHANGED not sent yet*/
+    int64_t mLastKeptPts; /*pts of last frame not decimated,ns unit*/
+
+    //pts reorder window,min heap of pts,guarded by mInputMutex
+    int mReorderDepth; /*0 if no reorder*/
+    std::vector<RenderBuffer *> mReorderFrames;
+    int64_t mLastEmittedPts; /*pts of last frame emitted to queue,ns unit*/
+    int64_t mLastReorderInputUs; /*system time of last frame put to window*/
     int mReleaseFrameCnt;
     int mDropFrameCnt; /*the frame cnt that droped by mediasync*/
     int mDisplayedFrameCnt;
     int mInFrameCnt;
 
+    //qos,used by display thread
+    int mQosIntervalMs; /*0 if no qos msg*/
+    RenderQos mQos;
+    int64_t mQosLastSendUs;
+    bool mQosBehind; /*last qos msg reported falling behind*/
+
     //fps
     int mVideoFPS;
     int mVideoFPS_N; //fps numerator
     int mVideoFPS_D; //fps denominator
 
-    //fps detection,ms
-    int mFPSIntervalMs;
-    int mFPSDetectCnt;
-    int mFPSDetectAcc;
+    //fps detection,guarded by mInputMutex
+    FrameRateEstimator mFrameRateEstimator;
+    int64_t mFrameIntervalNs; /*content frame interval,0 if unknown*/
     //plugin
     RenderPlugin *mPlugin;
     bool mIsLimitDisplayFrame;
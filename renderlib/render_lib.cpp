@@ -4,6 +4,13 @@
 #include "render_core.h"
 #include "Logger.h"
 #include <mutex>
+#include <thread>
+#include <memory>
+#include <list>
+#include <vector>
+#include <string>
+#include "Times.h"
+#include "config.h"
 
 #ifdef  __cplusplus
 extern "C" {
@@ -15,6 +22,121 @@ extern "C" {
 static int g_renderlibId = 0;
 static std::mutex g_mutext;
 
+/*plugin parked by render_close,reused by next session of same compositor*/
+typedef struct {
+    std::string compositor;
+    int pip;
+    RenderPlugin *plugin;
+    int64_t parkedTimeUs;
+} ParkedPlugin;
+//guarded by g_mutext,newest at back
+static std::list<ParkedPlugin> g_parkedPlugins;
+
+static void destroyParkedPlugin(RenderPlugin *plugin)
+{
+    if (plugin->getState() & PLUGIN_STATE_WINDOW_OPENED) {
+        plugin->closeWindow();
+    }
+    if (plugin->getState() & PLUGIN_STATE_DISPLAY_OPENED) {
+        plugin->closeDisplay();
+    }
+    plugin->release();
+    delete plugin;
+}
+
+static void parkPlugin(const char *compositor, int pip, RenderPlugin *plugin)
+{
+    ParkedPlugin parked;
+    RenderPlugin *evicted = NULL;
+
+    g_mutext.lock();
+    parked.compositor = compositor;
+    parked.pip = pip;
+    parked.plugin = plugin;
+    parked.parkedTimeUs = Tls::Times::getSystemTimeUs();
+    g_parkedPlugins.push_back(parked);
+    if (g_parkedPlugins.size() > SESSION_CACHE_MAX_PLUGINS) {
+        evicted = g_parkedPlugins.front().plugin;
+        g_parkedPlugins.pop_front();
+    }
+    g_mutext.unlock();
+
+    if (evicted) {
+        destroyParkedPlugin(evicted);
+    }
+}
+
+/*close plugins not reused in SESSION_CACHE_IDLE_TIMEOUT_MS,
+checked on next open and close,no timer thread is left running
+when library is unloaded*/
+static void evictIdlePlugins()
+{
+    std::vector<RenderPlugin *> idlePlugins;
+    int64_t nowUs = Tls::Times::getSystemTimeUs();
+
+    g_mutext.lock();
+    //oldest at front
+    while (!g_parkedPlugins.empty() &&
+        nowUs - g_parkedPlugins.front().parkedTimeUs > SESSION_CACHE_IDLE_TIMEOUT_MS*1000LL) {
+        idlePlugins.push_back(g_parkedPlugins.front().plugin);
+        g_parkedPlugins.pop_front();
+    }
+    g_mutext.unlock();
+
+    for (size_t i = 0; i < idlePlugins.size(); i++) {
+        destroyParkedPlugin(idlePlugins[i]);
+    }
+}
+
+/*must hold g_mutext,wantPip is -1 if pip is not known yet*/
+static RenderPlugin *takeParkedPlugin(const char *compositor, int wantPip, int *pip)
+{
+    for (auto item = g_parkedPlugins.rbegin(); item != g_parkedPlugins.rend(); item++) {
+        if (item->compositor == compositor && (wantPip < 0 || item->pip == wantPip)) {
+            RenderPlugin *plugin = item->plugin;
+            *pip = item->pip;
+            g_parkedPlugins.erase(std::next(item).base());
+            return plugin;
+        }
+    }
+    return NULL;
+}
+
+/*old devices closed by render_promote,their threads are joined
+when done,so no teardown thread outlives library unload*/
+typedef struct {
+    std::thread thread;
+    std::shared_ptr<std::atomic<bool>> done;
+} Teardown;
+static std::mutex g_teardownMutex;
+//guarded by g_teardownMutex
+static std::list<Teardown> g_teardowns;
+
+static void joinTeardowns(bool all)
+{
+    std::list<Teardown> finished;
+
+    g_teardownMutex.lock();
+    for (auto item = g_teardowns.begin(); item != g_teardowns.end();) {
+        auto cur = item++;
+        if (all || *cur->done) {
+            finished.splice(finished.end(), g_teardowns, cur);
+        }
+    }
+    g_teardownMutex.unlock();
+
+    for (auto item = finished.begin(); item != finished.end(); item++) {
+        item->thread.join();
+    }
+}
+
+/*destroyed before teardown list on library unload*/
+static struct TeardownJoiner {
+    ~TeardownJoiner() {
+        joinTeardowns(true);
+    };
+} g_teardownJoiner;
+
 void *render_open_with_tag(char *name, char *userTag)
 {
     //generate a renderlib id
@@ -22,6 +144,8 @@ void *render_open_with_tag(char *name, char *userTag)
     int renderlibId;
     int category = NO_CATEGERY;
 
+    evictIdlePlugins();
+    joinTeardowns(false);
     g_mutext.lock();
     Logger_init();
 
@@ -52,6 +176,13 @@ void *render_open_with_tag(char *name, char *userTag)
     INFO(category,"open");
     RenderCore *render = new RenderCore(renderlibId, category);
     render->init(name);
+    //pip and window size are not known yet,newest parked plugin of
+    //this compositor is taken,pip is checked again on connect
+    int pip = 0;
+    RenderPlugin *parked = takeParkedPlugin(render->getCompositorName(), -1, &pip);
+    if (parked) {
+        render->attachPlugin(parked, pip);
+    }
     g_mutext.unlock();
     return (void*)render;
 }
@@ -72,7 +203,22 @@ void render_set_user_data(void *handle, void *userdata)
 
 int render_connect(void *handle)
 {
-    return static_cast<RenderCore *>(handle)->connect();
+    RenderCore *render = static_cast<RenderCore *>(handle);
+    int pip = 0;
+
+    //window opened with other pip flag is parked again for its
+    //kind of session,a parked one of this pip flag is taken instead
+    RenderPlugin *mismatched = render->returnMismatchedPlugin(&pip);
+    if (mismatched) {
+        parkPlugin(render->getCompositorName(), pip, mismatched);
+        g_mutext.lock();
+        RenderPlugin *parked = takeParkedPlugin(render->getCompositorName(), render->getVideoPip(), &pip);
+        if (parked) {
+            render->attachPlugin(parked, pip);
+        }
+        g_mutext.unlock();
+    }
+    return render->connect();
 }
 
 int render_display_frame(void *handle, RenderBuffer *buffer)
@@ -117,14 +263,59 @@ int render_close(void *handle)
     category = static_cast<RenderCore *>(handle)->getLogCategory();
     renderid = static_cast<RenderCore *>(handle)->getRenderlibId();
     INFO(category,"close end");
+    RenderPlugin *plugin = static_cast<RenderCore *>(handle)->detachPlugin();
+    if (plugin) {
+        parkPlugin(static_cast<RenderCore *>(handle)->getCompositorName(),
+            static_cast<RenderCore *>(handle)->getVideoPip(), plugin);
+    }
     static_cast<RenderCore *>(handle)->release();
     delete static_cast<RenderCore *>(handle);
+    evictIdlePlugins();
 
     Logger_set_userTag(renderid, NULL);
     //Logger_set_file(NULL);
     return 0;
 }
 
+int render_promote(void *standbyHandle, void *activeHandle)
+{
+    RenderCore *standby = static_cast<RenderCore *>(standbyHandle);
+    int hide = 1;
+
+    if (standby->promote() != NO_ERROR) {
+        return -1;
+    }
+    if (activeHandle) {
+        //standby is shown first,so there is no black gap
+        static_cast<RenderCore *>(activeHandle)->setProp(KEY_HIDE_VIDEO, (void *)&hide);
+        //old pipeline is torn down without blocking channel change,
+        //user is told when its handle is gone
+        RenderCallback callback;
+        RenderCallback *activeCallback = static_cast<RenderCore *>(activeHandle)->getCallback();
+        void *userData = static_cast<RenderCore *>(activeHandle)->getUserData();
+        memset(&callback, 0, sizeof(RenderCallback));
+        if (activeCallback) {
+            callback = *activeCallback;
+        }
+        Teardown teardown;
+        teardown.done = std::make_shared<std::atomic<bool>>(false);
+        std::shared_ptr<std::atomic<bool>> done = teardown.done;
+        joinTeardowns(false);
+        g_teardownMutex.lock();
+        teardown.thread = std::thread([activeHandle, callback, userData, done]() {
+            render_disconnect(activeHandle);
+            render_close(activeHandle);
+            if (callback.doMsgSend) {
+                callback.doMsgSend(userData, MSG_TEARDOWN_DONE, activeHandle);
+            }
+            *done = true;
+        });
+        g_teardowns.push_back(std::move(teardown));
+        g_teardownMutex.unlock();
+    }
+    return 0;
+}
+
 RenderBuffer *render_allocate_render_buffer_wrap(void *handle, int flag, int rawBufferSize)
 {
     RenderCore * renderCore = static_cast<RenderCore *>(handle);
@@ -54,6 +54,32 @@ enum _RenderKey {
     KEY_KEEP_LAST_FRAME, //set/get keep last frame when play end ,value type is int, 0 not keep, 1 keep
     KEY_HIDE_VIDEO, //set/get hide video,it effect immediatialy,value type is int, 0 not hide, 1 hide
     KEY_FORCE_ASPECT_RATIO, //set/gst force pixel aspect ratio,value type is int, 1 is force,0 is not force
+    KEY_DISPLAY_CADENCE, //get content frame rate against display refresh rate,value type is RenderDisplayCadence
+    //set/get low latency mode,value type is int,0 normal,1 only latest frame is kept and displayed as soon as
+    //compositor can take it,a/v sync is bypassed,for game streaming or camera preview
+    KEY_LOW_LATENCY_MODE,
+    //set/get depth of pts reorder window,value type is int,0 disable,max 8.frames are displayed in pts order,
+    //duplicated frames in window and frames too late to be in order are dropped
+    KEY_REORDER_DEPTH,
+    //set/get show first frame at once after start or flush without waiting a/v sync,value type is int,
+    //0 disable,1 enable,default 0
+    KEY_FAST_FIRST_FRAME,
+    KEY_QUEUE_MAX_DEPTH, //set/get max frames count of render queue,value type is int,0 is unlimited,default 0
+    KEY_QUEUE_FULL_POLICY, //set/get action when render queue is full,value type is int,see enum _RenderQueueFullPolicy
+    //set/get jitter buffer,value type is int,0 disable,1 enable.frames are held in queue to cover input arrival
+    //jitter and presentation is slewed to keep queue depth,for network streams without mediasync
+    KEY_JITTER_BUFFER,
+    //set window size applied with the frame of given pts on display thread,value type is RenderWindowSizeAtPts.
+    //changes wait their frames in pts order,a later change of other key or pts does not cancel them
+    KEY_WINDOW_SIZE_AT_PTS,
+    KEY_FRAME_SIZE_AT_PTS, //set frame size applied with the frame of given pts,value type is RenderFrameSizeAtPts
+    KEY_QOS_INTERVAL, //set/get min interval of MSG_QOS,value type is int,ms unit,0 disable,default 500
+    //set/get standby,value type is int,1 video is hidden and only newest frames are cached without display,
+    //0 or render_promote makes the instance active,for fast channel change
+    KEY_STANDBY,
+    //set/get display on process wide shared display thread,value type is int,0 own display thread,1 shared.
+    //frames of all shared instances due in a vsync are submitted in one wakeup,set it before first frame
+    KEY_SHARED_SCHEDULER,
     KEY_MEDIASYNC_INSTANCE_ID = 400, //set/get mediasync instance id, value type is int
     KEY_MEDIASYNC_PCR_PID, ///set/get mediasync pcr id ,value type is int
     KEY_MEDIASYNC_DEMUX_ID, //set/get mediasync demux id ,value type is int
@@ -72,6 +98,15 @@ enum _RenderKey {
     KEY_VIDEOTUNNEL_ID = 450,
 };
 
+/*action when render queue reaches KEY_QUEUE_MAX_DEPTH,
+ displaced frame is sent with MSG_DROPED_BUFFER and MSG_RELEASE_BUFFER*/
+typedef enum _RenderQueueFullPolicy {
+    QUEUE_FULL_POLICY_BLOCK = 0, //block caller until queue has space,drop new frame if timeout
+    QUEUE_FULL_POLICY_DROP_OLDEST, //drop oldest frame in queue
+    QUEUE_FULL_POLICY_DROP_NEWEST, //drop new frame
+    QUEUE_FULL_POLICY_RETURN_AGAIN, //render_display_frame returns -EAGAIN,caller sends frame again later
+} RenderQueueFullPolicy;
+
 /*video display window size
  if will be used by PROP_WINDOW_SIZE prop */
 typedef struct _RenderWindowSize {
@@ -81,6 +116,19 @@ typedef struct _RenderWindowSize {
     int h;
 } RenderWindowSize;
 
+#define RENDER_CADENCE_PATTERN_LEN 5
+
+/*content frame rate against display refresh rate,
+ it will be used by KEY_DISPLAY_CADENCE prop,rates are mHz,
+ 0 if unknown*/
+typedef struct _RenderDisplayCadence {
+    int refreshRate; //current display refresh rate
+    int contentRate; //detected content frame rate
+    int preferredRefreshRate; //refresh rate matching content,same or integer multiple of content rate
+    int judder; //1 if frames can't be displayed in same vsyncs count,e.g. 24fps on 60Hz
+    int pattern[RENDER_CADENCE_PATTERN_LEN]; //vsyncs count of successive frames,e.g. 2,3,2,3,2 of 24fps on 60Hz
+} RenderDisplayCadence;
+
 /*frame size info
  it will be used by PROP_UPDATE_FRAME_SIZE prop*/
 typedef struct _RenderFrameSize {
@@ -88,6 +136,39 @@ typedef struct _RenderFrameSize {
     int frameHeight;
 } RenderFrameSize;
 
+/*window size applied with a frame,
+ it will be used by KEY_WINDOW_SIZE_AT_PTS prop*/
+typedef struct _RenderWindowSizeAtPts {
+    RenderWindowSize winSize;
+    int64_t pts; //ns unit,applied with first frame of pts not less than it,-1 is at once
+} RenderWindowSizeAtPts;
+
+/*frame size applied with a frame,
+ it will be used by KEY_FRAME_SIZE_AT_PTS prop*/
+typedef struct _RenderFrameSizeAtPts {
+    RenderFrameSize frameSize;
+    int64_t pts; //ns unit,applied with first frame of pts not less than it,-1 is at once
+} RenderFrameSizeAtPts;
+
+/*upstream action suggested by MSG_QOS*/
+enum _RenderQosAction {
+    QOS_ACTION_NONE = 0, //rendering keeps up
+    QOS_ACTION_SKIP_NON_REF, //frames are late,decoder should skip non-reference frames
+    QOS_ACTION_LOWER_RESOLUTION, //frames are dropped heavily,source should lower resolution or bitrate
+};
+
+/*rendering quality of service,modeled on gstreamer qos event,
+ it will be used by MSG_QOS msg*/
+typedef struct _RenderQos {
+    int64_t pts; //ns unit,pts of most recent frame
+    int64_t lateUs; //lateness of most recent frame against its display time,negative is early
+    int dropRate; //smoothed ratio of frames dropped for being late,per thousand
+    int queueDepth; //frames waiting display in render queue
+    int processed; //frames displayed or dropped since start
+    int dropped; //frames dropped for being late since start
+    int action; //suggested action,see enum _RenderQosAction
+} RenderQos;
+
 typedef enum _RenderMsgType {
     //frame buffer is released
     MSG_RELEASE_BUFFER   = 100, //the msg type is RenderBuffer
@@ -95,6 +176,18 @@ typedef enum _RenderMsgType {
     MSG_DISPLAYED_BUFFER = 101, //the msg type is RenderBuffer
     //the frame buffer is droped
     MSG_DROPED_BUFFER = 102,//the msg type is RenderBuffer
+    //display refresh rate does not match content,user should switch display mode
+    MSG_DISPLAY_REFRESH_RATE_REQUEST = 103, //the msg type is int,the preferred refresh rate mHz
+    //frames closer than interval in pts are released without display at high playback rate,
+    //decoder could skip non-reference frames
+    MSG_DECIMATION_CHANGED = 104, //the msg type is int64_t,the min pts interval ns of displayed frames,0 if no decimation
+    //first frame after start or flush is sent to display without a/v sync,a/v sync begins from next frame
+    MSG_FIRST_FRAME_PREROLLED = 105, //the msg type is RenderBuffer
+    //rendering falls behind or recovers,sent at most every KEY_QOS_INTERVAL ms,
+    //decoder could shed work before frames are dropped
+    MSG_QOS = 106, //the msg type is RenderQos
+    //active device passed to render_promote is disconnected and closed,it is the last msg of that device
+    MSG_TEARDOWN_DONE = 107, //the msg type is the closed handle,it must not be used
 
     //render lib connected failed
     MSG_CONNECTED_FAIL   = 200, //the msg type is string
@@ -283,7 +376,8 @@ int render_connect(void *handle);
  * until render lib release it, so please allcating buffer from memory heap
  * @param handle a handle of render device that was opened
  * @param buffer a video buffer will be displayed
- * @return 0 sucess,-1 fail
+ * @return 0 sucess,-1 fail,-EAGAIN if queue is full and queue full policy is
+ *      QUEUE_FULL_POLICY_RETURN_AGAIN,buffer is not obtained and should be sent again
  */
 int render_display_frame(void *handle, RenderBuffer *buffer);
 
@@ -340,6 +434,18 @@ int render_disconnect(void *handle);
  */
 int render_close(void *handle);
 
+/**
+ * promote a standby render device to active,its cached frame
+ * is shown at once.the active device is hidden,then disconnected
+ * and closed asynchronously,its handle must not be used after
+ * this call,its callbacks may still come until MSG_TEARDOWN_DONE
+ * is sent to it,the user data of it must be kept until then
+ * @param standbyHandle a handle of render device in standby
+ * @param activeHandle a handle of active render device,NULL if none
+ * @return 0 sucess,-1 fail
+ */
+int render_promote(void *standbyHandle, void *activeHandle);
+
 
 /**********************tools func for render devices***************************/
 /**
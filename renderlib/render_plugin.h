@@ -31,6 +31,8 @@ struct _PluginCallback {
  */
 enum _PluginMsg {
     PLUGIN_MSG_NOTIFY = 0, //msg of notity
+    PLUGIN_MSG_FRAME_PRESENTED = 100, //msg of frame presented by compositor,detail type is PluginFramePresented
+    PLUGIN_MSG_DISPLAY_MODE_CHANGED, //msg of display output mode changed,detail type is PluginDisplayMode
     PLUGIN_MSG_DISPLAY_OPEN_SUCCESS = 200, //msg of display open success
     PLUGIN_MSG_WINDOW_OPEN_SUCCESS, //msg of window open success
     PLUGIN_MSG_DISPLAY_CLOSE_SUCCESS, //msg of window close success
@@ -67,6 +69,7 @@ enum _PluginKey {
     PLUGIN_KEY_KEEP_LAST_FRAME, //set/get keep last frame when play end ,value type is int, 0 not keep, 1 keep
     PLUGIN_KEY_HIDE_VIDEO, //set/get hide video,it effect immediatialy,value type is int, 0 not hide, 1 hide
     PLUGIN_KEY_FORCE_ASPECT_RATIO, //set/gst force pixel aspect ratio,value type is int, 1 is force,0 is not force
+    PLUGIN_KEY_COMMIT_BATCH, //set commit batch of shared display scheduler,value type is int, 1 begin, 0 end and publish staged frame
 };
 
 typedef struct {
@@ -81,6 +84,27 @@ typedef struct {
     int h;
 } PluginFrameSize;
 
+/**
+ * @brief the presentation info of a frame,all times are
+ * systemtime us unit
+ */
+typedef struct {
+    RenderBuffer *buffer;
+    int64_t displayTimeUs; //the time frame is scheduled to display
+    int64_t submitTimeUs; //the time frame is submitted to compositor
+    int64_t presentedTimeUs; //the time compositor presented frame
+} PluginFramePresented;
+
+
+/**
+ * @brief the current display output mode,size is 0 if
+ * compositor does not report it
+ */
+typedef struct {
+    int width;
+    int height;
+    int refreshRate; //mHz unit
+} PluginDisplayMode;
 
 /**
  * render plugin interface
@@ -154,7 +178,8 @@ class RenderPlugin {
      *
      * @param buffer video frame buffer
      * @param displayTime the frame render realtime
-     * @return int 0 sucess,other fail
+     * @return int 0 sucess, ERROR_WOULD_BLOCK if compositor is busy
+     *   and buffer is not taken, caller still owns the buffer, other fail
      */
     virtual int displayFrame(RenderBuffer *buffer, int64_t displayTime) = 0;
     /**
@@ -49,6 +49,9 @@ MonitorThread::MonitorThread(SinkManager *sinkMgr)
     mUeventFd = -1;
     mLockFd = -1;
     mSocketServerFd = -1;
+    mHandoffServerFd = -1;
+    mHandedOff = false;
+    mPredecessorServing = false;
     mPoll = new Poll(true);
     DEBUG(NO_CATEGERY,"out");
 }
@@ -73,6 +76,14 @@ MonitorThread::~MonitorThread()
         close(mSocketServerFd);
         mSocketServerFd = -1;
     }
+    if (mHandoffServerFd >= 0) {
+        close(mHandoffServerFd);
+        mHandoffServerFd = -1;
+    }
+    if (mLockFd >= 0) {
+        close(mLockFd);
+        mLockFd = -1;
+    }
     DEBUG(NO_CATEGERY,"out");
 }
 
@@ -197,6 +208,68 @@ exit:
    return result;
 }
 
+bool MonitorThread::openHandoffMonitor()
+{
+    const char *workingDir;
+    int rc, pathNameLen, addressSize;
+
+    DEBUG(NO_CATEGERY,"in");
+    workingDir = getenv("XDG_RUNTIME_DIR");
+    if ( !workingDir )
+    {
+        ERROR(NO_CATEGERY,"XDG_RUNTIME_DIR is not set");
+        return false;
+    }
+
+    pathNameLen = strlen(workingDir)+strlen("/")+strlen(HANDOFF_SOCKET_NAME)+1;
+    if ( pathNameLen > (int)sizeof(mHandoffAddr.sun_path) )
+    {
+        ERROR(NO_CATEGERY,"name for handoff unix domain socket is too long: %d versus max %d",
+             pathNameLen, (int)sizeof(mHandoffAddr.sun_path) );
+        return false;
+    }
+
+    mHandoffAddr.sun_family= AF_LOCAL;
+    strcpy(mHandoffAddr.sun_path, workingDir );
+    strcat(mHandoffAddr.sun_path, "/" );
+    strcat(mHandoffAddr.sun_path, HANDOFF_SOCKET_NAME);
+
+    (void)unlink(mHandoffAddr.sun_path);
+
+    //records are framed by socket,one handoff msg per recvmsg
+    mHandoffServerFd = socket( PF_LOCAL, SOCK_SEQPACKET|SOCK_CLOEXEC, 0 );
+    if ( mHandoffServerFd < 0 )
+    {
+        ERROR(NO_CATEGERY,"unable to open handoff socket: errno %d", errno );
+        return false;
+    }
+
+    addressSize = pathNameLen + offsetof(struct sockaddr_un, sun_path);
+
+    rc= bind(mHandoffServerFd, (struct sockaddr *)&mHandoffAddr, addressSize );
+    if ( rc < 0 )
+    {
+        ERROR(NO_CATEGERY,"bind failed for handoff socket: errno %d", errno );
+        goto exit;
+    }
+
+    rc= listen(mHandoffServerFd, 1);
+    if ( rc < 0 )
+    {
+        ERROR(NO_CATEGERY,"listen failed for handoff socket: errno %d", errno );
+        goto exit;
+    }
+
+    INFO(NO_CATEGERY,"handoffServerFd %d", mHandoffServerFd);
+    DEBUG(NO_CATEGERY,"out");
+    return true;
+exit:
+    close(mHandoffServerFd);
+    mHandoffServerFd = -1;
+    mHandoffAddr.sun_path[0]= '\0';
+    return false;
+}
+
 bool MonitorThread::ueventEventProcess()
 {
     int ret;
@@ -287,6 +360,181 @@ bool MonitorThread::socketEventProcess()
     return true;
 }
 
+/*send listen,lock and uevent fds to successor, then all sinks*/
+bool MonitorThread::handoffEventProcess()
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov[1];
+    unsigned char mbody[4];
+    char cmbody[CMSG_SPACE(3*sizeof(int))];
+    int *fds;
+    int fd;
+    int sentLen;
+
+    fd = accept4(mHandoffServerFd, NULL, NULL, SOCK_CLOEXEC );
+    if ( fd < 0 ) {
+        WARNING(NO_CATEGERY,"accept handoff fail,errno:%d",errno);
+        return true;
+    }
+    INFO(NO_CATEGERY,"successor render server connected,start handoff");
+
+    mbody[0] = 'V';
+    mbody[1] = 'S';
+    mbody[2] = 1;
+    mbody[3] = 'L';
+
+    iov[0].iov_base = (char*)mbody;
+    iov[0].iov_len = 4;
+
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmbody;
+    msg.msg_controllen = sizeof(cmbody);
+    msg.msg_flags = 0;
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(3*sizeof(int));
+    fds = (int*)CMSG_DATA(cmsg);
+    //lock fd is shared with successor,so flock is kept held
+    fds[0] = mSocketServerFd;
+    fds[1] = mLockFd;
+    fds[2] = mUeventFd;
+
+    do
+    {
+        sentLen = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+    while ( (sentLen < 0) && (errno == EINTR));
+
+    if (sentLen != 4) {
+        ERROR(NO_CATEGERY,"send listen fds fail,errno:%d, keep running",errno);
+        close(fd);
+        return true;
+    }
+
+    //listen fds sent are copies,they are kept if sinks are not taken
+    if (!mSinkMgr->handoffSinks(fd)) {
+        ERROR(NO_CATEGERY,"handoff sinks fail,keep running");
+        close(fd);
+        return true;
+    }
+    close(fd);
+
+    //socket paths belong to successor now,do not unlink them
+    mHandedOff = true;
+    INFO(NO_CATEGERY,"handoff done");
+    //return false to exit thread
+    return false;
+}
+
+bool MonitorThread::takeover()
+{
+    struct sockaddr_un addr;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov[1];
+    unsigned char mbody[4];
+    char cmbody[CMSG_SPACE(3*sizeof(int))];
+    const char *workingDir;
+    int fd, len, rc, pathNameLen, addressSize;
+    bool ret;
+
+    DEBUG(NO_CATEGERY,"in");
+    workingDir = getenv("XDG_RUNTIME_DIR");
+    if ( !workingDir )
+    {
+        ERROR(NO_CATEGERY,"XDG_RUNTIME_DIR is not set");
+        return false;
+    }
+
+    pathNameLen = strlen(workingDir)+strlen("/")+strlen(HANDOFF_SOCKET_NAME)+1;
+    if ( pathNameLen > (int)sizeof(addr.sun_path) )
+    {
+        ERROR(NO_CATEGERY,"name for handoff unix domain socket is too long");
+        return false;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family= AF_LOCAL;
+    strcpy(addr.sun_path, workingDir );
+    strcat(addr.sun_path, "/" );
+    strcat(addr.sun_path, HANDOFF_SOCKET_NAME);
+    addressSize = pathNameLen + offsetof(struct sockaddr_un, sun_path);
+
+    fd = socket( PF_LOCAL, SOCK_SEQPACKET|SOCK_CLOEXEC, 0 );
+    if ( fd < 0 )
+    {
+        ERROR(NO_CATEGERY,"unable to open handoff socket: errno %d", errno );
+        return false;
+    }
+
+    rc = connect(fd, (struct sockaddr *)&addr, addressSize);
+    if ( rc < 0 )
+    {
+        ERROR(NO_CATEGERY,"connect to running render server fail: errno %d", errno );
+        close(fd);
+        return false;
+    }
+
+    iov[0].iov_base = (char*)mbody;
+    iov[0].iov_len = sizeof(mbody);
+
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = cmbody;
+    msg.msg_controllen = sizeof(cmbody);
+    msg.msg_flags = 0;
+
+    do
+    {
+        len = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    }
+    while ( (len < 0) && (errno == EINTR));
+
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (len != 4 || mbody[3] != 'L' || !cmsg ||
+        cmsg->cmsg_level != SOL_SOCKET ||
+        cmsg->cmsg_type != SCM_RIGHTS ||
+        cmsg->cmsg_len < CMSG_LEN(3*sizeof(int))) {
+        ERROR(NO_CATEGERY,"receive listen fds fail,len:%d",len);
+        close(fd);
+        return false;
+    }
+
+    mSocketServerFd = ((int*)CMSG_DATA(cmsg))[0];
+    mLockFd = ((int*)CMSG_DATA(cmsg))[1];
+    mUeventFd = ((int*)CMSG_DATA(cmsg))[2];
+    INFO(NO_CATEGERY,"took over socketServerFd %d,lockFd %d,ueventFd %d",
+        mSocketServerFd, mLockFd, mUeventFd);
+
+    ret = mSinkMgr->adoptSinks(fd);
+    close(fd);
+    if (!ret) {
+        //predecessor keeps serving with its own listen fds
+        ERROR(NO_CATEGERY,"adopt sinks fail,predecessor keeps running");
+        close(mSocketServerFd);
+        close(mLockFd);
+        close(mUeventFd);
+        mSocketServerFd = -1;
+        mLockFd = -1;
+        mUeventFd = -1;
+        mPredecessorServing = true;
+        return false;
+    }
+
+    //wait for next successor
+    openHandoffMonitor();
+    DEBUG(NO_CATEGERY,"out");
+    return true;
+}
+
 /*read first msg and parse vdecport*/
 int MonitorThread::parseVdecPort(int clientfd)
 {
@@ -340,6 +588,10 @@ bool MonitorThread::init()
     ret = openSocketMonitor();
     if (!ret) {
         ERROR(NO_CATEGERY,"open socket monitor fail");
+        return ret;
+    }
+    if (!openHandoffMonitor()) {
+        WARNING(NO_CATEGERY,"open handoff monitor fail,restart will drop sessions");
     }
     return ret;
 }
@@ -355,6 +607,10 @@ void MonitorThread::readyToRun()
         mPoll->addFd(mSocketServerFd);
         mPoll->setFdReadable(mSocketServerFd, true);
     }
+    if (mHandoffServerFd >= 0) {
+        mPoll->addFd(mHandoffServerFd);
+        mPoll->setFdReadable(mHandoffServerFd, true);
+    }
     DEBUG(NO_CATEGERY,"out");
 }
 
@@ -376,6 +632,9 @@ bool MonitorThread::threadLoop()
     if (mPoll->isReadable(mSocketServerFd)) {
         socketEventProcess();
     }
+    if (mHandoffServerFd >= 0 && mPoll->isReadable(mHandoffServerFd)) {
+        return handoffEventProcess();
+    }
 
     return true;
 }
\ No newline at end of file
@@ -20,12 +20,40 @@
 class RenderServer;
 #define MAX_SUN_PATH (80)
 #define SOCKET_NAME "render"
+#define HANDOFF_SOCKET_NAME "render.handoff"
 
 class MonitorThread : public Tls::Thread {
   public:
     MonitorThread(SinkManager *sinkMgr);
     virtual ~MonitorThread();
     bool init();
+    /**
+     * @brief take over the listen socket, uevent socket and all
+     * sinks from a running render server, the running server
+     * exits after handing off
+     *
+     * @return true if success
+     * @return false if failed,see isPredecessorServing
+     */
+    bool takeover();
+    /**
+     * @brief check if a failed takeover left the running render
+     * server serving its sinks,this server must exit then
+     *
+     * @return true if predecessor keeps serving
+     */
+    bool isPredecessorServing() {
+        return mPredecessorServing;
+    };
+    /**
+     * @brief check if this server had handed off its sinks
+     * to a successor render server
+     *
+     * @return true if handed off
+     */
+    bool isHandedOff() {
+        return mHandedOff;
+    };
 
     //thread func
     void readyToRun();
@@ -35,12 +63,18 @@ class MonitorThread : public Tls::Thread {
     bool openSocketMonitor();
     bool ueventEventProcess();
     bool socketEventProcess();
+    bool openHandoffMonitor();
+    bool handoffEventProcess();
     int parseVdecPort(int clientfd);
     int mUeventFd;
     char mLockName[MAX_SUN_PATH+6];
     int mLockFd;
     struct sockaddr_un mAddr;
     int mSocketServerFd;
+    struct sockaddr_un mHandoffAddr;
+    int mHandoffServerFd;
+    bool mHandedOff;
+    bool mPredecessorServing;
     Tls::Poll *mPoll;
     mutable Tls::Mutex mMutex;
     SinkManager *mSinkMgr;
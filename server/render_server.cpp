@@ -60,12 +60,25 @@ RenderServer::~RenderServer()
 }
 
 
-void RenderServer::createMonitorThread()
+bool RenderServer::createMonitorThread(bool takeover)
 {
-    bool ret;
+    bool ret = false;
     mMonitorThread = new MonitorThread(mSinkMgr);
-    ret = mMonitorThread->init();
+    if (takeover) {
+        ret = mMonitorThread->takeover();
+        if (!ret && mMonitorThread->isPredecessorServing()) {
+            ERROR(NO_CATEGERY,"takeover fail,running server keeps sessions");
+            return false;
+        }
+        if (!ret) {
+            WARNING(NO_CATEGERY,"takeover fail,init a new server");
+        }
+    }
+    if (!ret) {
+        ret = mMonitorThread->init();
+    }
     mMonitorThread->run("monitorThread");
+    return true;
 }
 
 void RenderServer::destroyMonitorThread()
@@ -76,11 +89,21 @@ void RenderServer::destroyMonitorThread()
     }
 }
 
+bool RenderServer::isHandedOff()
+{
+    if (mMonitorThread) {
+        return mMonitorThread->isHandedOff();
+    }
+    return false;
+}
+
 static bool g_running= false;
 static class RenderServer *g_renderServer = NULL;
 
 int main( int argc, char** argv)
 {
+    bool takeover = false;
+
     //open log file
     char *env = getenv("VIDEO_RENDER_LOG_FILE");
     if (env && strlen(env) > 0) {
@@ -94,13 +117,28 @@ int main( int argc, char** argv)
         Logger_set_level(level);
         INFO(NO_CATEGERY,"VIDEO_RENDER_LOG_LEVEL=%d",level);
     }
+    //--takeover: adopt sessions from the running render server
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--takeover")) {
+            takeover = true;
+        }
+    }
     g_renderServer = new RenderServer();
-    g_renderServer->createMonitorThread();
+    if (!g_renderServer->createMonitorThread(takeover)) {
+        g_renderServer->destroyMonitorThread();
+        delete g_renderServer;
+        g_renderServer = NULL;
+        return 1;
+    }
 
     g_running= true;
     while ( g_running )
     {
         usleep( 10000 );
+        if (g_renderServer->isHandedOff()) {
+            INFO(NO_CATEGERY,"sessions handed off,exit");
+            g_running = false;
+        }
     }
     g_renderServer->destroyMonitorThread();
     delete g_renderServer;
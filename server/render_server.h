@@ -21,8 +21,16 @@ class RenderServer {
   public:
     RenderServer();
     virtual ~RenderServer();
-    void createMonitorThread();
+    /**
+     * @brief create monitor thread
+     *
+     * @param takeover take over sessions from a running render server
+     * @return false if takeover failed and running render server
+     * keeps its sessions,this server must exit
+     */
+    bool createMonitorThread(bool takeover);
     void destroyMonitorThread();
+    bool isHandedOff();
   private:
     MonitorThread *mMonitorThread;
     SinkManager *mSinkMgr;
@@ -13,6 +13,23 @@
 
 #define INVALIDE_PORT (0xAFFFFFFF)
 
+/**
+ * @brief the session state of a sink that client set once
+ * when connecting,it is handed to a successor render server
+ * so that the successor can adopt the session
+ */
+typedef struct {
+    int winX;
+    int winY;
+    int winW;
+    int winH;
+    int fpsNum;
+    int fpsDenom;
+    int sessionId;
+    int syncType;
+    bool paused;
+} SinkSessionState;
+
 class Sink {
   public:
     /**
@@ -56,6 +73,24 @@ class Sink {
     virtual void getSinkPort(uint32_t *vdecPort, uint32_t *vdoPort) = 0;
 
     virtual bool isSocketSink() = 0;
+
+    /**
+     * @brief stop sink work but keep the client connection open,
+     * the in-flight buffers are released to client before return
+     *
+     * @param state output param, the session state of this sink
+     * @return int the client socket fd or -1 if sink has no client socket,
+     *  caller owns the returned fd
+     */
+    virtual int detach(SinkSessionState *state) = 0;
+
+    /**
+     * @brief restore session state that was detached from
+     * a former render server, must be called after start
+     *
+     * @param state the session state
+     */
+    virtual void restoreState(SinkSessionState *state) = 0;
 };
 
 #endif /*__SINK_INTERFACE_H__*/
\ No newline at end of file
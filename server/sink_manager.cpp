@@ -10,6 +10,10 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <poll.h>
 #include "sink_manager.h"
 #include "socket_sink.h"
 #include "vdo_sink.h"
@@ -167,6 +171,324 @@ bool SinkManager::destroySink(int vdecPort, int vdoPort)
     return true;
 }
 
+bool SinkManager::sendHandoffSink(int fd, HandoffSink *sink)
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov[1];
+    unsigned char mbody[4+HANDOFF_SINK_MSG_LEN];
+    char cmbody[CMSG_SPACE(sizeof(int))];
+    int len;
+    int sentLen;
+
+    len = 0;
+    mbody[len++] = 'V';
+    mbody[len++] = 'S';
+    mbody[len++] = HANDOFF_SINK_MSG_LEN;
+    mbody[len++] = 'H';
+    len += putU32(&mbody[len], sink->vdecPort);
+    len += putU32(&mbody[len], sink->vdoPort);
+    mbody[len++] = sink->isSocketSink ? 1 : 0;
+    len += putU32(&mbody[len], sink->state.winX);
+    len += putU32(&mbody[len], sink->state.winY);
+    len += putU32(&mbody[len], sink->state.winW);
+    len += putU32(&mbody[len], sink->state.winH);
+    len += putU32(&mbody[len], sink->state.fpsNum);
+    len += putU32(&mbody[len], sink->state.fpsDenom);
+    len += putU32(&mbody[len], sink->state.sessionId);
+    len += putU32(&mbody[len], sink->state.syncType);
+    mbody[len++] = sink->state.paused ? 1 : 0;
+
+    iov[0].iov_base = (char*)mbody;
+    iov[0].iov_len = len;
+
+    msg.msg_name = NULL;
+    msg.msg_namelen = 0;
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = NULL;
+    msg.msg_controllen = 0;
+    msg.msg_flags = 0;
+
+    if (sink->clientFd >= 0) {
+        msg.msg_control = cmbody;
+        msg.msg_controllen = sizeof(cmbody);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        *(int*)CMSG_DATA(cmsg) = sink->clientFd;
+    }
+
+    do
+    {
+        sentLen = sendmsg(fd, &msg, MSG_NOSIGNAL);
+    }
+    while ( (sentLen < 0) && (errno == EINTR));
+
+    INFO(NO_CATEGERY,"handoff sink vdecPort:%d,vdoPort:%d,socketsink:%d,clientfd:%d,sent:%d",
+        sink->vdecPort, sink->vdoPort, sink->isSocketSink, sink->clientFd, sentLen);
+    if (sentLen != len) {
+        ERROR(NO_CATEGERY,"send handoff sink fail,errno:%d",errno);
+        return false;
+    }
+    return true;
+}
+
+bool SinkManager::sendHandoffCtrl(int fd, unsigned char type)
+{
+    unsigned char mbody[4];
+    int sentLen;
+
+    mbody[0] = 'V';
+    mbody[1] = 'S';
+    mbody[2] = 1;
+    mbody[3] = type;
+    do
+    {
+        sentLen = send(fd, mbody, 4, MSG_NOSIGNAL);
+    }
+    while ( (sentLen < 0) && (errno == EINTR));
+
+    if (sentLen != 4) {
+        ERROR(NO_CATEGERY,"send handoff msg:%c fail,errno:%d",type,errno);
+        return false;
+    }
+    return true;
+}
+
+bool SinkManager::waitHandoffAck(int fd)
+{
+    struct pollfd pfd;
+    unsigned char mbody[4];
+    int len, rc;
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    do
+    {
+        rc = poll(&pfd, 1, HANDOFF_ACK_TIMEOUT_MS);
+    }
+    while ( (rc < 0) && (errno == EINTR));
+    if (rc <= 0) {
+        ERROR(NO_CATEGERY,"wait handoff ack fail,rc:%d,errno:%d",rc,errno);
+        return false;
+    }
+
+    do
+    {
+        len = recv(fd, mbody, sizeof(mbody), 0);
+    }
+    while ( (len < 0) && (errno == EINTR));
+    if (len != 4 || mbody[0] != 'V' || mbody[1] != 'S' || mbody[3] != 'A') {
+        ERROR(NO_CATEGERY,"bad handoff ack,len:%d,errno:%d",len,errno);
+        return false;
+    }
+    return true;
+}
+
+Sink *SinkManager::newHandoffSink(HandoffSink *sink)
+{
+    Sink *newSink;
+
+    if (sink->isSocketSink) {
+        newSink = new SocketSink(this, sink->clientFd, sink->vdecPort);
+    } else {
+        newSink = new VDOSink(this, sink->vdecPort, sink->vdoPort);
+    }
+    newSink->setVdoPort(sink->vdoPort);
+    return newSink;
+}
+
+bool SinkManager::handoffSinks(int fd)
+{
+    HandoffSink sinks[MAX_SINKS];
+    int cnt = 0;
+    bool ret = true;
+
+    Tls::Mutex::Autolock _l(mMutex);
+    INFO(NO_CATEGERY,"handoff sink cnt:%d",mSinkCnt);
+    for (int i = 0; i < MAX_SINKS; i++) {
+        if (!mAllSinks[i]) {
+            continue;
+        }
+        sinks[cnt].isSocketSink = mAllSinks[i]->isSocketSink();
+        mAllSinks[i]->getSinkPort(&sinks[cnt].vdecPort, &sinks[cnt].vdoPort);
+        sinks[cnt].clientFd = mAllSinks[i]->detach(&sinks[cnt].state);
+        delete mAllSinks[i];
+        mAllSinks[i] = NULL;
+        --mSinkCnt;
+        cnt++;
+    }
+
+    for (int i = 0; i < cnt && ret; i++) {
+        ret = sendHandoffSink(fd, &sinks[i]);
+    }
+    //successor starts sinks only after acking,so sessions are
+    //served by one server at a time
+    if (ret) {
+        ret = sendHandoffCtrl(fd, 'E') && waitHandoffAck(fd);
+    }
+
+    for (int i = 0; i < cnt; i++) {
+        if (ret) {
+            //successor has its own copy of client fd now
+            if (sinks[i].clientFd >= 0) {
+                close(sinks[i].clientFd);
+            }
+            continue;
+        }
+        //successor did not take sessions,keep serving them
+        for (int j = 0; j < MAX_SINKS; j++) {
+            if (!mAllSinks[j]) {
+                mAllSinks[j] = newHandoffSink(&sinks[i]);
+                ++mSinkCnt;
+                mAllSinks[j]->start();
+                mAllSinks[j]->restoreState(&sinks[i].state);
+                break;
+            }
+        }
+    }
+    if (!ret) {
+        ERROR(NO_CATEGERY,"handoff fail,keep serving sink cnt:%d",mSinkCnt);
+    }
+    return ret;
+}
+
+bool SinkManager::adoptSinks(int fd)
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct iovec iov[1];
+    unsigned char mbody[4+HANDOFF_SINK_MSG_LEN];
+    char cmbody[CMSG_SPACE(sizeof(int))];
+    unsigned char *m;
+    int len;
+    HandoffSink sinks[MAX_SINKS];
+    int cnt = 0;
+    bool ret = false;
+
+    while (true) {
+        iov[0].iov_base = (char*)mbody;
+        iov[0].iov_len = sizeof(mbody);
+
+        msg.msg_name = NULL;
+        msg.msg_namelen = 0;
+        msg.msg_iov = iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmbody;
+        msg.msg_controllen = sizeof(cmbody);
+        msg.msg_flags = 0;
+
+        do
+        {
+            len = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+        }
+        while ( (len < 0) && (errno == EINTR));
+
+        //take passed client fd first,it is closed if msg is rejected
+        int clientFd = -1;
+        cmsg = len > 0? CMSG_FIRSTHDR(&msg) : NULL;
+        if (cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+            cmsg->cmsg_type == SCM_RIGHTS &&
+            cmsg->cmsg_len >= CMSG_LEN(sizeof(int))) {
+            clientFd = *(int*)CMSG_DATA(cmsg);
+        }
+
+        if (len < 4) {
+            ERROR(NO_CATEGERY,"handoff socket closed before end,len:%d,errno:%d",len,errno);
+            if (clientFd >= 0) {
+                close(clientFd);
+            }
+            break;
+        }
+
+        m = mbody;
+        if (m[0] != 'V' || m[1] != 'S') {
+            ERROR(NO_CATEGERY,"bad handoff msg");
+            if (clientFd >= 0) {
+                close(clientFd);
+            }
+            break;
+        }
+        if (m[3] == 'E') {
+            if (clientFd >= 0) {
+                close(clientFd);
+            }
+            ret = true;
+            break;
+        }
+        //header is 3 bytes,msg len counts type byte and body
+        if (m[3] != 'H' || m[2] != HANDOFF_SINK_MSG_LEN || len != 3+HANDOFF_SINK_MSG_LEN ||
+            (msg.msg_flags & MSG_TRUNC)) {
+            WARNING(NO_CATEGERY,"unknown handoff msg:%c,len:%d",m[3],len);
+            if (clientFd >= 0) {
+                close(clientFd);
+            }
+            continue;
+        }
+
+        HandoffSink *sink = &sinks[cnt];
+        m += 4;
+        sink->vdecPort = getU32(m); m += 4;
+        sink->vdoPort = getU32(m); m += 4;
+        sink->isSocketSink = (*m++) != 0;
+        sink->state.winX = getU32(m); m += 4;
+        sink->state.winY = getU32(m); m += 4;
+        sink->state.winW = getU32(m); m += 4;
+        sink->state.winH = getU32(m); m += 4;
+        sink->state.fpsNum = getU32(m); m += 4;
+        sink->state.fpsDenom = getU32(m); m += 4;
+        sink->state.sessionId = (int)getU32(m); m += 4;
+        sink->state.syncType = (int)getU32(m); m += 4;
+        sink->state.paused = (*m++) != 0;
+        sink->clientFd = clientFd;
+
+        INFO(NO_CATEGERY,"adopt sink vdecPort:%d,vdoPort:%d,socketsink:%d,clientfd:%d",
+            sink->vdecPort, sink->vdoPort, sink->isSocketSink, clientFd);
+
+        //a session that can not be adopted fails the handoff,
+        //predecessor keeps serving all of them
+        if (cnt >= MAX_SINKS || (sink->isSocketSink && clientFd < 0)) {
+            ERROR(NO_CATEGERY,"can not adopt sink,sink cnt:%d",cnt);
+            if (clientFd >= 0) {
+                close(clientFd);
+            }
+            break;
+        }
+        cnt++;
+    }
+
+    Tls::Mutex::Autolock _l(mMutex);
+    if (ret && cnt > MAX_SINKS - mSinkCnt) {
+        ERROR(NO_CATEGERY,"no room to adopt sinks,sink cnt:%d,handoff cnt:%d",mSinkCnt,cnt);
+        ret = false;
+    }
+    if (ret) {
+        ret = sendHandoffCtrl(fd, 'A');
+    }
+    for (int i = 0; i < cnt; i++) {
+        if (!ret) {
+            if (sinks[i].clientFd >= 0) {
+                close(sinks[i].clientFd);
+            }
+            continue;
+        }
+        for (int j = 0; j < MAX_SINKS; j++) {
+            if (!mAllSinks[j]) {
+                mAllSinks[j] = newHandoffSink(&sinks[i]);
+                ++mSinkCnt;
+                mAllSinks[j]->start();
+                mAllSinks[j]->restoreState(&sinks[i].state);
+                break;
+            }
+        }
+    }
+    INFO(NO_CATEGERY,"handoff end,adopted:%d,sink cnt:%d",ret,mSinkCnt);
+    return ret;
+}
+
 Sink *SinkManager::findSinkByVdecPort(int vdecPort)
 {
     for (int i = 0; i < MAX_SINKS; i++) {
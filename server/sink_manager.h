@@ -18,6 +18,19 @@
 
 #define MAX_SINKS (2)
 #define WAIT_SOCKET_TIME_MS (500)
+//handoff sink record, 'V','S',len,'H' and body,len counts 'H' and body
+#define HANDOFF_SINK_MSG_LEN (43)
+//max wait for successor to ack adopted sinks
+#define HANDOFF_ACK_TIMEOUT_MS (3000)
+
+/*a detached sink sent over handoff socket*/
+typedef struct {
+    uint32_t vdecPort;
+    uint32_t vdoPort;
+    bool isSocketSink;
+    int clientFd;
+    SinkSessionState state;
+} HandoffSink;
 
 class SinkManager : public Tls::Thread {
   public:
@@ -27,6 +40,27 @@ class SinkManager : public Tls::Thread {
     bool createVdoSink(int vdecPort, int vdoPort);
     bool createSocketSink(int socketfd, int vdecPort);
     bool destroySink(int vdecPort, int vdoPort);
+    /**
+     * @brief detach all sinks and send their ports, session state
+     * and client socket fds to a successor render server over
+     * the handoff socket, sinks are destroyed after successor
+     * acked, or recreated and kept serving if handoff fails
+     *
+     * @param fd the connected handoff socket fd
+     * @return true if success
+     * @return false if failed,sinks are still served here
+     */
+    bool handoffSinks(int fd);
+    /**
+     * @brief receive the sinks handed off by a predecessor render
+     * server, ack them, then recreate and start them and restore
+     * session state,nothing is started if any of them fails
+     *
+     * @param fd the connected handoff socket fd
+     * @return true if success
+     * @return false if failed,predecessor keeps serving the sinks
+     */
+    bool adoptSinks(int fd);
 
     //thread func
     virtual bool threadLoop();
@@ -47,6 +81,13 @@ class SinkManager : public Tls::Thread {
      * @return Sink* the special vdoPort sink or null
      */
     Sink *findSinkByVdoPort(int vdoPort);
+    bool sendHandoffSink(int fd, HandoffSink *sink);
+    bool sendHandoffCtrl(int fd, unsigned char type);
+    bool waitHandoffAck(int fd);
+    /**
+     * @brief create a sink of a handoff record,not started
+     */
+    Sink *newHandoffSink(HandoffSink *sink);
     void dumpSinkInfo();
     //LGE defined 2 vdo devices
     Sink *mAllSinks[MAX_SINKS];
@@ -66,7 +66,7 @@ void SocketSink::handleFrameDisplayed(void* userData, RenderBuffer *buffer)
     SocketSink *self = static_cast<SocketSink *>(userData);
     size_t bufferId = (size_t)buffer->priv;
     self->mRenderlib->getDroppedFrames(&droppedFrames);
-    self->videoServerSendStatus(buffer->pts, droppedFrames,bufferId);
+    self->videoServerSendStatus(buffer->pts, droppedFrames, bufferId, Tls::Times::getSystemTimeUs());
 }
 
 SocketSink::SocketSink(SinkManager *sinkMgr, int socketfd, uint32_t vdecPort)
@@ -83,6 +83,10 @@ SocketSink::SocketSink(SinkManager *sinkMgr, int socketfd, uint32_t vdecPort)
     mIsPixFormatSet = false;
     mIsPeerSocketConnect = true;
     mVdoPort = INVALIDE_PORT;
+    memset(&mSessionState, 0, sizeof(SinkSessionState));
+    mSessionState.sessionId = -1;
+    mSessionState.syncType = -1;
+    mPoll = new Tls::Poll(true);
     TRACE2(NO_CATEGERY,"out");
 }
 
@@ -103,8 +107,13 @@ SocketSink::~SocketSink()
         mSocketFd = -1;
     }
     if (isRunning()) {
+        mPoll->setFlushing(true);
         requestExitAndWait();
     }
+    if (mPoll) {
+        delete mPoll;
+        mPoll = NULL;
+    }
     TRACE2(NO_CATEGERY,"out");
 }
 
@@ -156,17 +165,76 @@ bool SocketSink::stop()
         mSocketFd = -1;
     }
     if (isRunning()) {
+        mPoll->setFlushing(true);
         requestExitAndWait();
     }
     DEBUG(NO_CATEGERY,"out");
     return true;
 }
 
-void SocketSink::videoServerSendStatus(long long displayedFrameTime, int dropFrameCount, int bufIndex)
+int SocketSink::detach(SinkSessionState *state)
+{
+    int fd;
+
+    DEBUG(NO_CATEGERY,"in");
+    //stop receiving frames, the poll wakeup only lands between
+    //two messages, so no message is half read from socket
+    if (isRunning()) {
+        mPoll->setFlushing(true);
+        requestExitAndWait();
+    }
+    mState = STATE_STOP;
+
+    //disconnect render lib,all in-flight buffers are released
+    //and their release msgs are sent to client over the socket
+    if (mRenderlib) {
+        mRenderlib->disconnectRender();
+        delete mRenderlib;
+        mRenderlib = NULL;
+    }
+
+    if (state) {
+        memcpy(state, &mSessionState, sizeof(SinkSessionState));
+    }
+
+    //the client socket fd is owned by caller now
+    fd = mSocketFd;
+    mSocketFd = -1;
+    DEBUG(NO_CATEGERY,"out,socketfd:%d",fd);
+    return fd;
+}
+
+void SocketSink::restoreState(SinkSessionState *state)
+{
+    if (!state || !mRenderlib) {
+        return;
+    }
+    DEBUG(NO_CATEGERY,"win(%d,%d,%d,%d),fps:%d/%d,session:%d,synctype:%d,paused:%d",
+        state->winX,state->winY,state->winW,state->winH,state->fpsNum,state->fpsDenom,
+        state->sessionId,state->syncType,state->paused);
+    memcpy(&mSessionState, state, sizeof(SinkSessionState));
+    if (state->sessionId >= 0) {
+        mRenderlib->setMediasyncId(state->sessionId);
+    }
+    if (state->syncType >= 0) {
+        mRenderlib->setMediasyncSyncMode(state->syncType);
+    }
+    if (state->winW > 0 && state->winH > 0) {
+        mRenderlib->setWindowSize(state->winX, state->winY, state->winW, state->winH);
+    }
+    if (state->fpsNum > 0 && state->fpsDenom > 0) {
+        mRenderlib->setVideoFps(state->fpsNum, state->fpsDenom);
+    }
+    if (state->paused) {
+        mRenderlib->pause();
+    }
+}
+
+void SocketSink::videoServerSendStatus(long long displayedFrameTime, int dropFrameCount, int bufIndex, int64_t presentTimeUs)
 {
     struct msghdr msg;
     struct iovec iov[1];
-    unsigned char mbody[4+8+4+4];
+    unsigned char mbody[4+8+4+4+8];
     int len;
     int sentLen;
 
@@ -183,11 +251,12 @@ void SocketSink::videoServerSendStatus(long long displayedFrameTime, int dropFra
     len= 0;
     mbody[len++]= 'V';
     mbody[len++]= 'S';
-    mbody[len++]= 17;
+    mbody[len++]= 25;
     mbody[len++]= 'S';
     len += putS64( &mbody[len], displayedFrameTime );
     len += putU32( &mbody[len], dropFrameCount );
     len += putU32( &mbody[len], bufIndex );
+    len += putS64( &mbody[len], presentTimeUs );
 
     iov[0].iov_base= (char*)mbody;
     iov[0].iov_len= len;
@@ -436,6 +505,7 @@ bool SocketSink::processEvent()
                     {
                         bool pause= (m[1] == 1);
                         DEBUG(NO_CATEGERY,"got pause (%d)", pause);
+                        mSessionState.paused = pause;
                         if (pause) {
                             mRenderlib->pause();
                         } else {
@@ -448,6 +518,8 @@ bool SocketSink::processEvent()
                         int syncType= m[1];
                         int sessionId= getU32( m+2 );
                         DEBUG(NO_CATEGERY,"got session info: sync type %d sessionId %d", syncType, sessionId);
+                        mSessionState.sessionId = sessionId;
+                        mSessionState.syncType = syncType;
                         mRenderlib->setMediasyncId(sessionId);
                         mRenderlib->setMediasyncSyncMode(syncType);
                     }
@@ -459,6 +531,10 @@ bool SocketSink::processEvent()
                         rectW= (int)getU32( m+9 );
                         rectH= (int)getU32( m+13 );
                         DEBUG(NO_CATEGERY,"got position : (%d, %d, %d, %d)",rectX, rectY, rectW, rectH);
+                        mSessionState.winX = rectX;
+                        mSessionState.winY = rectY;
+                        mSessionState.winW = rectW;
+                        mSessionState.winH = rectH;
                         mRenderlib->setWindowSize(rectX, rectY, rectW, rectH);
                     }
                     break;
@@ -468,6 +544,8 @@ bool SocketSink::processEvent()
                         num= (int)getU32( m+1 );
                         denom= (int)getU32( m+5 );
                         DEBUG(NO_CATEGERY,"got frame rate  (%d / %d)", num, denom);
+                        mSessionState.fpsNum = num;
+                        mSessionState.fpsDenom = denom;
                         mRenderlib->setVideoFps(num, denom);
                     }
                     break;
@@ -486,6 +564,10 @@ void SocketSink::readyToRun()
 {
     DEBUG(NO_CATEGERY,"in");
     mState = STATE_RUNNING;
+    if (mPoll && mSocketFd >= 0) {
+        mPoll->addFd(mSocketFd);
+        mPoll->setFdReadable(mSocketFd, true);
+    }
 
     DEBUG(NO_CATEGERY,"out");
 }
@@ -510,6 +592,14 @@ bool SocketSink::threadLoop()
         return false;
     }
 
+    ret = mPoll->wait(-1); //wait for ever
+    if (ret < 0) { //poll error or flushing
+        WARNING(NO_CATEGERY,"poll error");
+        return false;
+    } else if (ret == 0) { //poll time out
+        return true; //run loop
+    }
+
     ret = processEvent();
     if (!ret) { //exit thread
         mIsPeerSocketConnect = false;
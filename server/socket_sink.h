@@ -51,6 +51,8 @@ class SocketSink : public Sink , public Tls::Thread {
     States getState() {
         return mState;
     };
+    int detach(SinkSessionState *state);
+    void restoreState(SinkSessionState *state);
 
     //thread func
     void readyToRun();
@@ -61,13 +63,20 @@ class SocketSink : public Sink , public Tls::Thread {
     //buffer had displayed ,but not release
     static void handleFrameDisplayed(void *userData, RenderBuffer *buffer);
   private:
-    void videoServerSendStatus(long long displayedFrameTime, int dropFrameCount, int bufIndex);
+    /**
+     * @brief send displayed frame status to client
+     *
+     * @param presentTimeUs systemtime us frame is presented,client
+     * corrects its display latency estimate by it
+     */
+    void videoServerSendStatus(long long displayedFrameTime, int dropFrameCount, int bufIndex, int64_t presentTimeUs);
     void videoServerSendBufferRelease(int bufferId);
     int adaptFd(int fdin);
     bool processEvent();
     SinkManager *mSinkMgr;
     int mSocketFd;
     Tls::Mutex mMutex;
+    Tls::Poll *mPoll;
 
     uint32_t mVdoPort;
     uint32_t mVdecPort;
@@ -81,6 +90,9 @@ class SocketSink : public Sink , public Tls::Thread {
     bool mIsPixFormatSet;
     bool mIsPeerSocketConnect;
 
+    //session state set by client, handed to successor server
+    SinkSessionState mSessionState;
+
     RenderLibWrap *mRenderlib;
 };
 
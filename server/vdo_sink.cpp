@@ -276,6 +276,21 @@ bool VDOSink::stop()
     return true;
 }
 
+int VDOSink::detach(SinkSessionState *state)
+{
+    DEBUG(NO_CATEGERY,"in");
+    //vdo sink has no client connection, the successor
+    //reconnects vdo with the same vdec and vdo port
+    stop();
+    if (state) {
+        memset(state, 0, sizeof(SinkSessionState));
+        state->sessionId = -1;
+        state->syncType = -1;
+    }
+    DEBUG(NO_CATEGERY,"out");
+    return -1;
+}
+
 bool VDOSink::voutConnect()
 {
     int rc;
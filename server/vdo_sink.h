@@ -48,6 +48,8 @@ class VDOSink : public Sink, public Tls::Thread {
     States getState() {
         return mState;
     };
+    int detach(SinkSessionState *state);
+    void restoreState(SinkSessionState *state) {};
     //thread func
     void readyToRun();
     virtual bool threadLoop();
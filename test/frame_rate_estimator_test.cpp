@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include "frame_rate_estimator.h"
+
+static int gFailed = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d check failed: %s\n", __FILE__, __LINE__, #cond); \
+        gFailed++; \
+    } \
+} while (0)
+
+static int64_t addFrames(FrameRateEstimator *estimator, int64_t pts, int64_t intervalNs, int cnt)
+{
+    for (int i = 0; i < cnt; i++) {
+        estimator->addPts(pts);
+        pts += intervalNs;
+    }
+    return pts;
+}
+
+static void testConstantRate()
+{
+    FrameRateEstimator estimator;
+
+    //deltas are one less than frames
+    addFrames(&estimator, 0, 40000000LL, FPS_ESTIMATE_MIN_SAMPLES);
+    CHECK(estimator.getIntervalNs() == 0);
+    addFrames(&estimator, FPS_ESTIMATE_MIN_SAMPLES*40000000LL, 40000000LL, 1);
+    CHECK(estimator.getIntervalNs() == 40000000LL);
+    CHECK(estimator.getConfidence() == 100);
+    CHECK(!estimator.isPulldownCadence());
+}
+
+static void testDiscontinuityNotCounted()
+{
+    FrameRateEstimator estimator;
+    int64_t pts;
+
+    pts = addFrames(&estimator, 0, 40000000LL, FPS_ESTIMATE_WINDOW);
+    //jump forward over one second and back,both are not deltas
+    pts = addFrames(&estimator, pts + 5000000000LL, 40000000LL, 2);
+    addFrames(&estimator, 1000000LL, 40000000LL, 2);
+    CHECK(estimator.getIntervalNs() == 40000000LL);
+    CHECK(estimator.getConfidence() == 100);
+}
+
+static void testRateChangeFollowed()
+{
+    FrameRateEstimator estimator;
+    int64_t pts;
+
+    pts = addFrames(&estimator, 0, 40000000LL, FPS_ESTIMATE_WINDOW);
+    CHECK(estimator.getIntervalNs() == 40000000LL);
+    addFrames(&estimator, pts, 20000000LL, FPS_ESTIMATE_WINDOW + 1);
+    CHECK(estimator.getIntervalNs() == 20000000LL);
+}
+
+static void testPulldownCadence()
+{
+    FrameRateEstimator estimator;
+    int64_t fieldNs = 16683333LL;
+    int64_t pts = 0;
+
+    //24fps telecined to 60 fields,frames last two and three fields
+    for (int i = 0; i < FPS_ESTIMATE_WINDOW + 1; i++) {
+        estimator.addPts(pts);
+        pts += (i % 2)? 3*fieldNs : 2*fieldNs;
+    }
+    CHECK(estimator.isPulldownCadence());
+    CHECK(estimator.getIntervalNs() == 5*fieldNs/2);
+    estimator.reset();
+    CHECK(!estimator.isPulldownCadence());
+    CHECK(estimator.getIntervalNs() == 0);
+}
+
+int main(int argc, char **argv)
+{
+    testConstantRate();
+    testDiscontinuityNotCounted();
+    testRateChangeFollowed();
+    testPulldownCadence();
+    printf("frame_rate_estimator_test %s\n", gFailed? "FAILED" : "passed");
+    return gFailed? 1 : 0;
+}
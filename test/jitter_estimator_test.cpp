@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include "jitter_estimator.h"
+
+static int gFailed = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d check failed: %s\n", __FILE__, __LINE__, #cond); \
+        gFailed++; \
+    } \
+} while (0)
+
+#define FRAME_INTERVAL_NS (40000000LL)
+
+static void testSteadyArrival()
+{
+    JitterEstimator estimator;
+
+    for (int i = 0; i < JITTER_ESTIMATE_MIN_SAMPLES - 1; i++) {
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 1000000LL + i*FRAME_INTERVAL_NS/1000, 1.0f);
+    }
+    CHECK(estimator.getJitterUs() == 0);
+    for (int i = JITTER_ESTIMATE_MIN_SAMPLES - 1; i < JITTER_ESTIMATE_WINDOW; i++) {
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 1000000LL + i*FRAME_INTERVAL_NS/1000, 1.0f);
+    }
+    CHECK(estimator.getJitterUs() == 0);
+}
+
+static void testLateArrivalSpread()
+{
+    JitterEstimator estimator;
+
+    //every other frame arrives 8ms late
+    for (int i = 0; i < JITTER_ESTIMATE_WINDOW; i++) {
+        int64_t lateUs = (i % 2)? 8000 : 0;
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 1000000LL + i*FRAME_INTERVAL_NS/1000 + lateUs, 1.0f);
+    }
+    CHECK(estimator.getJitterUs() == 8000);
+}
+
+static void testRateChangeRestarts()
+{
+    JitterEstimator estimator;
+
+    for (int i = 0; i < JITTER_ESTIMATE_WINDOW; i++) {
+        int64_t lateUs = (i % 2)? 8000 : 0;
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 1000000LL + i*FRAME_INTERVAL_NS/1000 + lateUs, 1.0f);
+    }
+    CHECK(estimator.getJitterUs() == 8000);
+    //frames arrive twice as fast at rate 2,old delays are dropped
+    for (int i = 0; i < JITTER_ESTIMATE_MIN_SAMPLES; i++) {
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 9000000LL + i*FRAME_INTERVAL_NS/2000, 2.0f);
+    }
+    CHECK(estimator.getJitterUs() == 0);
+}
+
+static void testPtsDiscontinuityRestarts()
+{
+    JitterEstimator estimator;
+
+    for (int i = 0; i < JITTER_ESTIMATE_WINDOW; i++) {
+        int64_t lateUs = (i % 2)? 8000 : 0;
+        estimator.addArrival(i*FRAME_INTERVAL_NS, 1000000LL + i*FRAME_INTERVAL_NS/1000 + lateUs, 1.0f);
+    }
+    //pts jumps back to 0 long after,delay is far over a second
+    estimator.addArrival(0, 60000000LL, 1.0f);
+    CHECK(estimator.getJitterUs() == 0);
+}
+
+int main(int argc, char **argv)
+{
+    testSteadyArrival();
+    testLateArrivalSpread();
+    testRateChangeRestarts();
+    testPtsDiscontinuityRestarts();
+    printf("jitter_estimator_test %s\n", gFailed? "FAILED" : "passed");
+    return gFailed? 1 : 0;
+}
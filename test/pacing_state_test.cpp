@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include "pacing_state.h"
+
+static int gFailed = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d check failed: %s\n", __FILE__, __LINE__, #cond); \
+        gFailed++; \
+    } \
+} while (0)
+
+static void testPrerollThenPlaying()
+{
+    PacingStateMachine pacing;
+
+    CHECK(pacing.getState() == PACING_STATE_IDLE);
+    CHECK(pacing.postEvent(PACING_EVENT_FRAME_QUEUED) == PACING_STATE_PREROLL);
+    CHECK(pacing.postEvent(PACING_EVENT_FRAME_SHOWN) == PACING_STATE_PLAYING);
+    CHECK(pacing.postQueueState(0, false) == PACING_STATE_IDLE);
+    CHECK(pacing.postEvent(PACING_EVENT_FRAME_QUEUED) == PACING_STATE_PLAYING);
+}
+
+static void testFrameQueuedDuringFlush()
+{
+    PacingStateMachine pacing;
+
+    pacing.postEvent(PACING_EVENT_FRAME_QUEUED);
+    pacing.postEvent(PACING_EVENT_FRAME_SHOWN);
+    CHECK(pacing.postEvent(PACING_EVENT_FLUSH_START) == PACING_STATE_FLUSHING);
+    //new generation frame queued before flush end,event is ignored
+    CHECK(pacing.postEvent(PACING_EVENT_FRAME_QUEUED) == PACING_STATE_FLUSHING);
+    CHECK(pacing.postEvent(PACING_EVENT_FLUSH_END) == PACING_STATE_IDLE);
+    //display thread released stale frames and finds the new one,
+    //it must display at once without waiting next frame
+    CHECK(pacing.postQueueState(1, false) == PACING_STATE_PREROLL);
+    CHECK(pacing.isDisplaying());
+}
+
+static void testFrameQueuedDuringReset()
+{
+    PacingStateMachine pacing;
+
+    pacing.postEvent(PACING_EVENT_FRAME_QUEUED);
+    pacing.postEvent(PACING_EVENT_FRAME_SHOWN);
+    CHECK(pacing.postEvent(PACING_EVENT_RESET) == PACING_STATE_IDLE);
+    CHECK(pacing.postQueueState(2, false) == PACING_STATE_PREROLL);
+}
+
+static void testPauseKeptAcrossFlush()
+{
+    PacingStateMachine pacing;
+
+    pacing.postEvent(PACING_EVENT_FRAME_QUEUED);
+    CHECK(pacing.postEvent(PACING_EVENT_PAUSE) == PACING_STATE_PAUSED);
+    pacing.postEvent(PACING_EVENT_FLUSH_START);
+    CHECK(pacing.postEvent(PACING_EVENT_FLUSH_END) == PACING_STATE_PAUSED);
+    //queued frames do not leave pause
+    CHECK(pacing.postQueueState(1, false) == PACING_STATE_PAUSED);
+    CHECK(pacing.postEvent(PACING_EVENT_RESUME) == PACING_STATE_PREROLL);
+}
+
+static void testFrameShownWhileFlushingIgnored()
+{
+    PacingStateMachine pacing;
+
+    pacing.postEvent(PACING_EVENT_FRAME_QUEUED);
+    pacing.postEvent(PACING_EVENT_FLUSH_START);
+    pacing.postEvent(PACING_EVENT_FRAME_SHOWN);
+    pacing.postEvent(PACING_EVENT_FLUSH_END);
+    //old generation frame shown must not skip preroll
+    CHECK(pacing.postQueueState(1, false) == PACING_STATE_PREROLL);
+}
+
+static void testReorderDraining()
+{
+    PacingStateMachine pacing;
+
+    pacing.postEvent(PACING_EVENT_FRAME_QUEUED);
+    CHECK(pacing.postQueueState(0, true) == PACING_STATE_DRAINING);
+    CHECK(pacing.postQueueState(1, true) == PACING_STATE_PREROLL);
+    CHECK(pacing.postQueueState(0, false) == PACING_STATE_IDLE);
+}
+
+int main(int argc, char **argv)
+{
+    testPrerollThenPlaying();
+    testFrameQueuedDuringFlush();
+    testFrameQueuedDuringReset();
+    testPauseKeptAcrossFlush();
+    testFrameShownWhileFlushingIgnored();
+    testReorderDraining();
+    printf("pacing_state_test %s\n", gFailed? "FAILED" : "passed");
+    return gFailed? 1 : 0;
+}
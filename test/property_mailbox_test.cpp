@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <string.h>
+#include "property_mailbox.h"
+
+static int gFailed = 0;
+static uint32_t gVersion = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("%s:%d check failed: %s\n", __FILE__, __LINE__, #cond); \
+        gFailed++; \
+    } \
+} while (0)
+
+static void postWindow(PropertyMailbox *mailbox, int64_t pts, int w)
+{
+    PropertySnapshot snapshot;
+
+    memset(&snapshot, 0, sizeof(PropertySnapshot));
+    snapshot.version = ++gVersion;
+    snapshot.pts = pts;
+    snapshot.changed = PROPERTY_CHANGED_WINDOW_SIZE;
+    snapshot.winSize.w = w;
+    mailbox->post(&snapshot);
+}
+
+static void postFrame(PropertyMailbox *mailbox, int64_t pts, int w)
+{
+    PropertySnapshot snapshot;
+
+    memset(&snapshot, 0, sizeof(PropertySnapshot));
+    snapshot.version = ++gVersion;
+    snapshot.pts = pts;
+    snapshot.changed = PROPERTY_CHANGED_FRAME_SIZE;
+    snapshot.frameWidth = w;
+    mailbox->post(&snapshot);
+}
+
+static void testUntargetedMerged()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    CHECK(!mailbox.fetch(-1, false, &props));
+    postWindow(&mailbox, -1, 100);
+    postFrame(&mailbox, -1, 200);
+    postWindow(&mailbox, -1, 300);
+    CHECK(mailbox.fetch(-1, false, &props));
+    CHECK(props.changed == (PROPERTY_CHANGED_WINDOW_SIZE | PROPERTY_CHANGED_FRAME_SIZE));
+    CHECK(props.winSize.w == 300);
+    CHECK(props.frameWidth == 200);
+    CHECK(!mailbox.fetch(-1, false, &props));
+}
+
+static void testUntargetedKeepsTargeted()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    postWindow(&mailbox, 1000, 100);
+    postFrame(&mailbox, -1, 200);
+    //untargeted change is applied at once,without targeted window
+    CHECK(mailbox.fetch(-1, false, &props));
+    CHECK(props.changed == PROPERTY_CHANGED_FRAME_SIZE);
+    CHECK(!mailbox.fetch(999, false, &props));
+    CHECK(mailbox.fetch(1000, false, &props));
+    CHECK(props.changed == PROPERTY_CHANGED_WINDOW_SIZE);
+    CHECK(props.winSize.w == 100);
+}
+
+static void testTargetedInPtsOrder()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    postWindow(&mailbox, 3000, 300);
+    postWindow(&mailbox, 1000, 100);
+    postFrame(&mailbox, 2000, 200);
+    CHECK(mailbox.fetch(1000, false, &props));
+    CHECK(props.changed == PROPERTY_CHANGED_WINDOW_SIZE && props.winSize.w == 100);
+    CHECK(mailbox.fetch(2500, false, &props));
+    CHECK(props.changed == PROPERTY_CHANGED_FRAME_SIZE && props.frameWidth == 200);
+    CHECK(mailbox.fetch(3000, false, &props));
+    CHECK(props.changed == PROPERTY_CHANGED_WINDOW_SIZE && props.winSize.w == 300);
+    CHECK(!mailbox.fetch(4000, false, &props));
+}
+
+static void testSameTargetLaterWins()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    postWindow(&mailbox, 1000, 100);
+    postFrame(&mailbox, 1000, 200);
+    postWindow(&mailbox, 1000, 300);
+    CHECK(mailbox.fetch(1000, false, &props));
+    CHECK(props.winSize.w == 300 && props.frameWidth == 200);
+}
+
+static void testForceAll()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    postWindow(&mailbox, 1000, 100);
+    postWindow(&mailbox, 2000, 200);
+    CHECK(mailbox.fetch(-1, true, &props));
+    CHECK(props.winSize.w == 200);
+    CHECK(!mailbox.fetch(3000, false, &props));
+}
+
+static void testFullFoldsOldest()
+{
+    PropertyMailbox mailbox;
+    PropertySnapshot props;
+
+    postFrame(&mailbox, 1000, 50);
+    for (int i = 1; i <= PROPERTY_MAILBOX_MAX_TARGETED; i++) {
+        postWindow(&mailbox, 1000 + i * 1000, i);
+    }
+    //oldest frame size is carried by the next target,not lost
+    CHECK(!mailbox.fetch(1000, false, &props));
+    CHECK(mailbox.fetch(2000, false, &props));
+    CHECK(props.frameWidth == 50 && props.winSize.w == 1);
+    CHECK(props.changed == (PROPERTY_CHANGED_WINDOW_SIZE | PROPERTY_CHANGED_FRAME_SIZE));
+}
+
+int main(int argc, char **argv)
+{
+    testUntargetedMerged();
+    testUntargetedKeepsTargeted();
+    testTargetedInPtsOrder();
+    testSameTargetLaterWins();
+    testForceAll();
+    testFullFoldsOldest();
+    printf("property_mailbox_test %s\n", gFailed? "FAILED" : "passed");
+    return gFailed? 1 : 0;
+}
@@ -157,9 +157,9 @@ int Poll::wait(int64_t timeoutNs /*nanosecond*/)
     }
 
     do {
-        int64_t t = -1; //nanosecond
+        int t = -1; //millisecond
         if (timeoutNs > 0) {
-            t = timeoutNs;
+            t = (int)((timeoutNs + 999999) / 1000000);
         }
         //DEBUG("waiting");
         activecnt = poll(mFds, mFdsCnt, t);
@@ -167,6 +167,12 @@ int Poll::wait(int64_t timeoutNs /*nanosecond*/)
         if (mFlushing.load()) {
             goto tag_flushing;
         }
+        //release the wakeup raised by wakeup(),it is not an fd event
+        if (activecnt > 0 && mControllable && mFds[0].fd == mControlReadFd &&
+            (mFds[0].revents & POLLIN)) {
+            releaseAllWakeup();
+            activecnt--;
+        }
     } while(0);
 
 tag_success:
@@ -199,6 +205,13 @@ void Poll::setFlushing(bool flushing)
     }
 }
 
+void Poll::wakeup()
+{
+    if (mControllable) {
+        raiseWakeup();
+    }
+}
+
 bool Poll::isReadable(int fd)
 {
     for (int i = 0; i < mFdsCnt; i++) {
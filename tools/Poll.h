@@ -86,6 +86,12 @@ class Poll {
      * @param flushing
      */
     void setFlushing(bool flushing);
+    /**
+     * @brief wakeup poll wait without flushing,wait will
+     * return and the caller can update fd events,
+     * e.g. enable writable after data is queued
+     */
+    void wakeup();
     /**
      * @brief check this fd if had data to read
      *